@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+
+# Recall and query latency of the approximate rp_forest neighbour search
+# against exact kdtree search, over an instance store of the default size
+# (--instance_store_size) on the bike streams and on a synthetic stream of
+# 51 attributes (50 numeric plus the class).
+
+import os
+import sys
+import random
+import tempfile
+path = r'./cmake-build-debug/'
+
+if path not in sys.path:
+    sys.path.append(path)
+
+from trans_pearl_wrapper import benchmark_neighbour_search
+
+store_size = 8000
+num_queries = 2000
+
+# gaussian clusters around uniform centres, labelled by cluster parity
+def write_wide_stream(filename, num_instances, num_features=50, num_clusters=20, seed=0):
+    rng = random.Random(seed)
+    centres = [[rng.uniform(0, 100) for _ in range(num_features)] for _ in range(num_clusters)]
+
+    with open(filename, 'w') as out:
+        out.write('@relation wide\n\n')
+        for i in range(num_features):
+            out.write(f'@attribute x{i} numeric\n')
+        out.write('@attribute class {0,1}\n\n@data\n')
+
+        for _ in range(num_instances):
+            cluster = rng.randrange(num_clusters)
+            out.write(','.join(f'{rng.gauss(v, 10):.4f}' for v in centres[cluster]))
+            out.write(f',{cluster % 2}\n')
+
+with tempfile.TemporaryDirectory() as data_dir:
+    wide_data_file = os.path.join(data_dir, 'wide-51.arff')
+    write_wide_stream(wide_data_file, store_size + num_queries)
+    data_files = ['data/bike/dc-weekday-source.arff', 'data/bike/weekday.arff', wide_data_file]
+
+    print("data_file,rp_forest_trees,rp_forest_leaf_size,recall,"
+          "kdtree_build_ms,kdtree_query_us,rp_forest_build_ms,rp_forest_query_us")
+    for data_file in data_files:
+        for num_trees in [1, 4, 8, 16]:
+            for leaf_size in [16, 32, 64]:
+                recall, kdtree_build, kdtree_query, rp_forest_build, rp_forest_query = \
+                    benchmark_neighbour_search(data_file, store_size, num_queries, num_trees, leaf_size)
+                print(f"{os.path.basename(data_file)},{num_trees},{leaf_size},{recall:.4f},"
+                      f"{kdtree_build:.2f},{kdtree_query:.2f},{rp_forest_build:.2f},{rp_forest_query:.2f}")
@@ -0,0 +1,23 @@
+#!/usr/bin/env python3
+
+# Update time of one compact tree leaf's Gaussian observers with the scalar
+# and AVX2 kernels, over all attributes and over every second attribute
+# (gathered), at the attribute counts of the bike, AGRAWAL-like and wide
+# streams. bench-observers.sh measures whole training runs.
+
+import sys
+path = r'./cmake-build-debug/'
+
+if path not in sys.path:
+    sys.path.append(path)
+
+from trans_pearl_wrapper import benchmark_observer_kernels
+
+num_updates = 2000000
+
+print("num_attributes,tracked_subset,scalar_ns,avx2_ns,speedup")
+for num_attributes in [4, 9, 40, 200]:
+    for tracked_subset in [False, True]:
+        scalar_ns, avx2_ns = benchmark_observer_kernels(num_attributes, tracked_subset, num_updates)
+        speedup = f"{scalar_ns / avx2_ns:.2f}" if avx2_ns > 0 else "n/a"
+        print(f"{num_attributes},{int(tracked_subset)},{scalar_ns:.1f},{avx2_ns:.1f},{speedup}")
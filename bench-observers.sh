@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+
+# foreground training time of streamDM's observers against the compact
+# tree's scalar and AVX2 observer kernels, on the all-numeric bike streams
+# (4 attributes). bench-observer-kernels.py times the kernels alone at up to
+# 200 attributes.
+
+transfer_streams_paths='data/bike/dc-weekday-source.arff;data/bike/weekend.arff'
+
+run() {
+    exp_code=$1
+    shift
+    rm -rf $exp_code
+    src/main.py --max_samples 10000000 --data_format arff --generator_name agrawal --generator_traits abrupt --generator_seed 0 \
+        -t 60 -c 120 -s --cd_kappa_threshold 0.0 --edit_distance_threshold 100 --reuse_rate_upper_bound 0.9 --reuse_rate_lower_bound 0.9 --reuse_window_size 0 --lossy_window_size 100000000 \
+        --kappa_window 60 --poisson_lambda 1 --random_state 0 \
+        --transfer_tree \
+        --transfer_streams_paths $transfer_streams_paths \
+        --exp_code $exp_code \
+        --boost_mode 'disable_transfer' \
+        "$@" > /dev/null
+
+    for result in $(find $exp_code -name 'result-stream-*.csv' | sort) ; do
+        echo "$exp_code $(basename $result): $(tail -n 1 $result | awk -F, '{print "accuracy", $2, "time", $NF}')"
+    done
+}
+
+run bench-observers-streamdm --tree_backend streamdm
+run bench-observers-scalar --tree_backend compact --observer_isa scalar
+run bench-observers-avx2 --tree_backend compact --observer_isa avx2
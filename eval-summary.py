@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+
+# Replay summary size vs. accuracy and runtime.
+# Expects one atradaboost run per summary size under the same exp_code, e.g.
+#   main.py ... --transfer_tree --boost_mode atradaboost --instance_summary_size 100
+# and one run without --instance_summary_size as the raw instance store baseline.
+
+import copy
+import os
+import sys
+import pandas as pd
+import numpy as np
+from dataclasses import dataclass
+
+summary_size_list = [0, 50, 100, 200, 400] # 0 replays the raw instance store
+
+@dataclass
+class Param:
+    exp_code: str = ""
+    kappa_window: int = 60
+    transfer_match_lowerbound: float = 0.0
+    least_transfer_warning_period_instances_length: int = 100
+    num_diff_distr_instances: int = 300
+    transfer_kappa_threshold: float = 0.4
+    bbt_pool_size: int = 40
+    gamma: float = 4
+    instance_summary_size: int = 0
+
+noise_agrawal_2_1 = \
+    Param(
+        exp_code= 'noise-0.2-0.1',
+        least_transfer_warning_period_instances_length = 100,
+        num_diff_distr_instances = 300,
+        transfer_kappa_threshold = 0.3,
+        bbt_pool_size = 10,
+        gamma = 4.0
+    )
+
+def is_empty_file(fpath):
+    return False if os.path.isfile(fpath) and os.path.getsize(fpath) > 0 else True
+
+
+def eval_summary(p, num_seeds):
+    path = f"{p.exp_code}/atradaboost/" \
+           f"{p.transfer_match_lowerbound}/" \
+           f"{p.kappa_window}/" \
+           f"{p.least_transfer_warning_period_instances_length}/" \
+           f"{p.num_diff_distr_instances}/" \
+           f"{p.transfer_kappa_threshold}/" \
+           f"{p.bbt_pool_size}/" \
+           f"{p.gamma}/"
+    if p.instance_summary_size > 0:
+        path = f"{path}/summary-{p.instance_summary_size}/"
+
+    acc_list = []
+    kappa_list = []
+    acc_gain_list = []
+    time_list = []
+
+    for seed in range(num_seeds):
+        result_path = f"{path}/{seed}/result-stream-1.csv"
+        disable_output = f"{p.exp_code}/disable_transfer/{seed}/result-stream-1.csv"
+        if is_empty_file(result_path) or is_empty_file(disable_output):
+            continue
+
+        benchmark_df = pd.read_csv(result_path)
+        disable_df = pd.read_csv(disable_output)
+
+        acc_list.extend(benchmark_df["accuracy"].to_list())
+        kappa_list.extend(benchmark_df["kappa"].to_list())
+        time_list.append(benchmark_df["time"].iloc[-1])
+
+        num_rows = min(len(benchmark_df), len(disable_df))
+        acc_gain_list.append((benchmark_df["accuracy"][:num_rows] - disable_df["accuracy"][:num_rows]).sum())
+
+    if len(time_list) == 0:
+        print(f"{p.instance_summary_size} & missing results\\\\")
+        return
+
+    metrics = []
+
+    acc = np.mean(acc_list) * 100
+    acc_std = np.std(acc_list) * 100
+    metrics.append(f"${acc:.2f}" + " \\pm " + f"{acc_std:.2f}$")
+
+    kappa = np.mean(kappa_list) * 100
+    kappa_std = np.std(kappa_list) * 100
+    metrics.append(f"${kappa:.2f}" + " \\pm " + f"{kappa_std:.2f}$")
+
+    acc_gain = np.mean(acc_gain_list) * 100
+    metrics.append(f"${round(acc_gain)}$")
+
+    time = np.mean(time_list)
+    time_std = np.std(time_list)
+    metrics.append(f"${time:.2f}" + " \\pm " + f"{time_std:.2f}$")
+
+    label = "raw" if p.instance_summary_size == 0 else p.instance_summary_size
+    print(f"{label} & " + " & ".join(metrics) + "\\\\")
+
+
+num_seeds = int(sys.argv[1]) if len(sys.argv) > 1 else 10
+
+print("summary size & accuracy & kappa & accuracy gain & time")
+for v in summary_size_list:
+    params = copy.deepcopy(noise_agrawal_2_1)
+    params.instance_summary_size = v
+    eval_summary(params, num_seeds)
@@ -0,0 +1,81 @@
+#include "attribute_workers.h"
+
+attribute_workers::attribute_workers(int num_workers) :
+        generation(0),
+        num_running(0) {
+
+    if (num_workers < 1) {
+        cout << "attribute_workers: num_workers must be positive" << endl;
+        exit(1);
+    }
+    for (int i = 1; i <= num_workers; i++) {
+        workers.emplace_back(&attribute_workers::run, this, i);
+    }
+}
+
+attribute_workers::~attribute_workers() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake_signal.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int attribute_workers::get_num_partitions() const {
+    return workers.size() + 1;
+}
+
+bool attribute_workers::try_run(int num_items, const std::function<void(int, int, int)>& fn) {
+    std::unique_lock<std::mutex> lock(run_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+
+    job = &fn;
+    job_items = num_items;
+    num_running = workers.size();
+    {
+        std::lock_guard<std::mutex> wake_lock(wake_mutex);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    wake_signal.notify_all();
+
+    run_partition(0);
+    while (num_running.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+    job = nullptr;
+    return true;
+}
+
+void attribute_workers::run_partition(int partition) {
+    long num_partitions = get_num_partitions();
+    int begin = (long) job_items * partition / num_partitions;
+    int end = (long) job_items * (partition + 1) / num_partitions;
+    if (begin < end) {
+        (*job)(partition, begin, end);
+    }
+}
+
+void attribute_workers::run(int partition) {
+    long seen = 0;
+    while (true) {
+        for (int spin = 0; spin < spin_limit && generation.load(std::memory_order_acquire) == seen; spin++) {
+            std::this_thread::yield();
+        }
+        if (generation.load(std::memory_order_acquire) == seen) {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_signal.wait(lock, [this, seen] { return stopping || generation.load() != seen; });
+            if (generation.load() == seen) {
+                return;
+            }
+        }
+
+        seen = generation.load(std::memory_order_acquire);
+        run_partition(partition);
+        num_running.fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef ATTRIBUTE_WORKERS_H
+#define ATTRIBUTE_WORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Vertical parallelism over the attributes of a leaf: the columns are split
+// into contiguous partitions, the caller takes partition 0 and each worker
+// always the same one of the rest, so a worker keeps updating the observers
+// of the same attributes while the leaf stays the same. Workers spin for a
+// while after a call before sleeping, calls come once per instance.
+class attribute_workers {
+public:
+    explicit attribute_workers(int num_workers);
+    ~attribute_workers();
+
+    // workers plus the calling thread
+    int get_num_partitions() const;
+
+    // calls fn(partition, begin, end) for every partition of [0, num_items)
+    // and returns once all have finished. Returns false without calling fn
+    // while another thread's call is running.
+    bool try_run(int num_items, const std::function<void(int, int, int)>& fn);
+
+private:
+    static const int spin_limit = 256;
+
+    std::mutex run_mutex;
+    std::mutex wake_mutex;
+    std::condition_variable wake_signal;
+    bool stopping = false;
+    std::atomic<long> generation;
+    std::atomic<int> num_running;
+    const std::function<void(int, int, int)>* job = nullptr;
+    int job_items = 0;
+    vector<std::thread> workers;
+
+    void run_partition(int partition);
+    void run(int partition);
+};
+
+#endif //ATTRIBUTE_WORKERS_H
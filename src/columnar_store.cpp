@@ -0,0 +1,501 @@
+#include "columnar_store.h"
+
+value_encoding_enum parse_value_encoding(const string& encoding_str) {
+    static const std::map<string, value_encoding_enum> value_encoding_map =
+            {
+                    { "float64", value_encoding_enum::float64_encoding },
+                    { "float32", value_encoding_enum::float32_encoding },
+                    { "uint16", value_encoding_enum::uint16_encoding },
+                    { "uint8", value_encoding_enum::uint8_encoding },
+            };
+
+    auto entry = value_encoding_map.find(encoding_str);
+    if (entry == value_encoding_map.end()) {
+        cout << "Invalid instance store encoding: " << encoding_str << endl;
+        exit(1);
+    }
+    return entry->second;
+}
+
+// class column_block
+column_block::column_block(int num_attributes, int block_size) :
+        num_attributes(num_attributes),
+        block_size(block_size) {}
+
+void column_block::append(Instance& instance) {
+    if (sealed || is_full()) {
+        cout << "column_block: append to a sealed block" << endl;
+        exit(1);
+    }
+
+    if (open_values.empty()) {
+        open_values.reserve((size_t) num_attributes * block_size);
+        labels.reserve(block_size);
+    }
+
+    for (int i = 0; i < num_attributes; i++) {
+        open_values.push_back(instance.getInputAttributeValue(i));
+    }
+
+    int label = instance.getLabel();
+    if (label < 0 || label > UINT8_MAX) {
+        cout << "column_block: label " << label << " does not fit into a byte" << endl;
+        exit(1);
+    }
+    labels.push_back((uint8_t) label);
+    num_rows++;
+}
+
+void column_block::seal(value_encoding_enum encoding) {
+    if (sealed) {
+        return;
+    }
+
+    columns.clear();
+    for (int i = 0; i < num_attributes; i++) {
+        columns.push_back(encode_column(i, encoding));
+    }
+
+    open_values.clear();
+    open_values.shrink_to_fit();
+    labels.shrink_to_fit();
+    sealed = true;
+}
+
+column_block::column column_block::encode_column(int att_idx, value_encoding_enum encoding) const {
+    column cur_column;
+
+    double min_val = std::numeric_limits<double>::max();
+    double max_val = std::numeric_limits<double>::lowest();
+    bool all_finite = true;
+    bool all_integer = true;
+    for (int row = 0; row < num_rows; row++) {
+        double val = open_values[(size_t) row * num_attributes + att_idx];
+        if (!std::isfinite(val)) {
+            all_finite = false;
+            break;
+        }
+        min_val = std::min(min_val, val);
+        max_val = std::max(max_val, val);
+        if (val != std::floor(val)) {
+            all_integer = false;
+        }
+    }
+    if (num_rows == 0) {
+        min_val = max_val = 0;
+    }
+    double range = max_val - min_val;
+
+    if (!all_finite) {
+        // missing values cannot be quantized
+        cur_column.encoding = value_encoding_enum::float64_encoding;
+    } else if (all_integer && range <= UINT8_MAX) {
+        cur_column.encoding = value_encoding_enum::uint8_encoding;
+        cur_column.offset = min_val;
+    } else if (all_integer && range <= UINT16_MAX) {
+        cur_column.encoding = value_encoding_enum::uint16_encoding;
+        cur_column.offset = min_val;
+    } else {
+        cur_column.encoding = encoding;
+        if (encoding == value_encoding_enum::uint16_encoding) {
+            cur_column.offset = min_val;
+            cur_column.scale = range > 0 ? range / UINT16_MAX : 1;
+        } else if (encoding == value_encoding_enum::uint8_encoding) {
+            cur_column.offset = min_val;
+            cur_column.scale = range > 0 ? range / UINT8_MAX : 1;
+        }
+    }
+
+    switch (cur_column.encoding) {
+        case value_encoding_enum::float64_encoding:
+            cur_column.codes.resize((size_t) num_rows * sizeof(double));
+            for (int row = 0; row < num_rows; row++) {
+                double val = open_values[(size_t) row * num_attributes + att_idx];
+                memcpy(&cur_column.codes[(size_t) row * sizeof(double)], &val, sizeof(double));
+            }
+            break;
+        case value_encoding_enum::float32_encoding:
+            cur_column.codes.resize((size_t) num_rows * sizeof(float));
+            for (int row = 0; row < num_rows; row++) {
+                float val = (float) open_values[(size_t) row * num_attributes + att_idx];
+                memcpy(&cur_column.codes[(size_t) row * sizeof(float)], &val, sizeof(float));
+            }
+            break;
+        case value_encoding_enum::uint16_encoding:
+            cur_column.codes.resize((size_t) num_rows * sizeof(uint16_t));
+            for (int row = 0; row < num_rows; row++) {
+                double val = open_values[(size_t) row * num_attributes + att_idx];
+                uint16_t code = (uint16_t) std::lround((val - cur_column.offset) / cur_column.scale);
+                memcpy(&cur_column.codes[(size_t) row * sizeof(uint16_t)], &code, sizeof(uint16_t));
+            }
+            break;
+        case value_encoding_enum::uint8_encoding:
+            cur_column.codes.resize(num_rows);
+            for (int row = 0; row < num_rows; row++) {
+                double val = open_values[(size_t) row * num_attributes + att_idx];
+                cur_column.codes[row] = (uint8_t) std::lround((val - cur_column.offset) / cur_column.scale);
+            }
+            break;
+    }
+
+    return cur_column;
+}
+
+double column_block::decode_value(const column& cur_column, int row) {
+    switch (cur_column.encoding) {
+        case value_encoding_enum::float64_encoding: {
+            double val;
+            memcpy(&val, &cur_column.codes[(size_t) row * sizeof(double)], sizeof(double));
+            return val;
+        }
+        case value_encoding_enum::float32_encoding: {
+            float val;
+            memcpy(&val, &cur_column.codes[(size_t) row * sizeof(float)], sizeof(float));
+            return val;
+        }
+        case value_encoding_enum::uint16_encoding: {
+            uint16_t code;
+            memcpy(&code, &cur_column.codes[(size_t) row * sizeof(uint16_t)], sizeof(uint16_t));
+            return cur_column.offset + code * cur_column.scale;
+        }
+        case value_encoding_enum::uint8_encoding:
+            return cur_column.offset + cur_column.codes[row] * cur_column.scale;
+    }
+
+    return 0;
+}
+
+bool column_block::is_full() const {
+    return num_rows >= block_size;
+}
+
+int column_block::size() const {
+    return num_rows;
+}
+
+int column_block::get_num_attributes() const {
+    return num_attributes;
+}
+
+double column_block::get_value(int row, int att_idx) const {
+    if (!sealed) {
+        return open_values[(size_t) row * num_attributes + att_idx];
+    }
+    return decode_value(columns[att_idx], row);
+}
+
+int column_block::get_label(int row) const {
+    return labels[row];
+}
+
+long column_block::get_memory_bytes() const {
+    long bytes = sizeof(column_block)
+                 + open_values.capacity() * sizeof(double)
+                 + labels.capacity();
+    for (auto& cur_column : columns) {
+        bytes += sizeof(column) + cur_column.codes.capacity();
+    }
+    return bytes;
+}
+
+void column_block::write_to(string& buffer, value_encoding_enum encoding) const {
+    write_value<int>(buffer, num_attributes);
+    write_value<int>(buffer, num_rows);
+    write_bytes(buffer, string(labels.begin(), labels.end()));
+
+    for (int i = 0; i < num_attributes; i++) {
+        column cur_column = sealed ? columns[i] : encode_column(i, encoding);
+        write_value<int>(buffer, (int) cur_column.encoding);
+        write_value<double>(buffer, cur_column.offset);
+        write_value<double>(buffer, cur_column.scale);
+        write_bytes(buffer, string(cur_column.codes.begin(), cur_column.codes.end()));
+    }
+}
+
+unique_ptr<column_block> column_block::read_from(const string& buffer, size_t& pos, int block_size) {
+    int num_attributes = read_value<int>(buffer, pos);
+    unique_ptr<column_block> block = make_unique<column_block>(num_attributes, block_size);
+
+    block->num_rows = read_value<int>(buffer, pos);
+    string label_bytes = read_bytes(buffer, pos);
+    block->labels.assign(label_bytes.begin(), label_bytes.end());
+
+    for (int i = 0; i < num_attributes; i++) {
+        column cur_column;
+        cur_column.encoding = (value_encoding_enum) read_value<int>(buffer, pos);
+        cur_column.offset = read_value<double>(buffer, pos);
+        cur_column.scale = read_value<double>(buffer, pos);
+        string codes = read_bytes(buffer, pos);
+        cur_column.codes.assign(codes.begin(), codes.end());
+        block->columns.push_back(std::move(cur_column));
+    }
+    block->sealed = true;
+
+    return block;
+}
+
+// class instance_log
+instance_log::instance_log(int block_size) :
+        block_size(block_size) {}
+
+void instance_log::set_encoding(value_encoding_enum encoding) {
+    this->encoding = encoding;
+}
+
+value_encoding_enum instance_log::get_encoding() const {
+    return encoding;
+}
+
+int instance_log::get_block_size() const {
+    return block_size;
+}
+
+InstanceInformation* instance_log::get_instance_information() const {
+    return instance_information;
+}
+
+long instance_log::append(Instance& instance) {
+    if (num_attributes == -1) {
+        num_attributes = instance.getNumberInputAttributes();
+        instance_information = instance.getInstanceInformation();
+    } else if (instance.getNumberInputAttributes() != num_attributes) {
+        cout << "instance_log: attribute count changed from " << num_attributes
+             << " to " << instance.getNumberInputAttributes() << endl;
+        exit(1);
+    }
+
+    if (open_block == nullptr || open_block->is_full()) {
+        // num_rows is on a block boundary here
+        open_block = make_shared<column_block>(num_attributes, block_size);
+    }
+
+    open_block->append(instance);
+    if (open_block->is_full()) {
+        open_block->seal(encoding);
+    }
+
+    return num_rows++;
+}
+
+shared_ptr<column_block> instance_log::get_open_block() const {
+    return open_block;
+}
+
+void instance_log::close_block() {
+    num_rows = (num_rows + block_size - 1) / block_size * block_size;
+    open_block = nullptr;
+}
+
+long instance_log::get_memory_bytes(set<const void*>& counted) const {
+    long bytes = sizeof(instance_log);
+    if (open_block != nullptr && counted.insert(open_block.get()).second) {
+        bytes += open_block->get_memory_bytes();
+    }
+    return bytes;
+}
+
+// class columnar_store
+void columnar_store::append(instance_log& log, long row) {
+    if (is_spilled()) {
+        cout << "columnar_store: append to a spilled store" << endl;
+        exit(1);
+    }
+    if (block_size == 0) {
+        block_size = log.get_block_size();
+        instance_information = log.get_instance_information();
+    }
+
+    if (!runs.empty() && runs.back().start + runs.back().count == row) {
+        runs.back().count++;
+    } else {
+        runs.push_back({ row, 1 });
+    }
+
+    attach_block(row / block_size, log.get_open_block());
+    num_rows++;
+}
+
+void columnar_store::attach_block(long block_idx, shared_ptr<column_block> block) {
+    if (first_block_idx == -1) {
+        first_block_idx = block_idx;
+    }
+
+    long pos = block_idx - first_block_idx;
+    if (pos >= (long) blocks.size()) {
+        blocks.resize(pos + 1);
+    }
+    if (blocks[pos] == nullptr) {
+        blocks[pos] = block;
+    }
+}
+
+size_t columnar_store::size() const {
+    return num_rows;
+}
+
+bool columnar_store::empty() const {
+    return num_rows == 0;
+}
+
+int columnar_store::get_num_attributes() const {
+    for (auto& block : blocks) {
+        if (block != nullptr) {
+            return block->get_num_attributes();
+        }
+    }
+    return 0;
+}
+
+long columnar_store::find_row(size_t idx) const {
+    // trees usually hold a single run
+    for (auto& cur_run : runs) {
+        if (idx < cur_run.count) {
+            return cur_run.start + idx;
+        }
+        idx -= cur_run.count;
+    }
+
+    cout << "columnar_store: row index out of range" << endl;
+    exit(1);
+}
+
+const column_block& columnar_store::block_of(long row) const {
+    if (is_spilled()) {
+        cout << "columnar_store: read from a spilled store" << endl;
+        exit(1);
+    }
+    return *blocks[row / block_size - first_block_idx];
+}
+
+double columnar_store::get_value(size_t idx, int att_idx) const {
+    long row = find_row(idx);
+    return block_of(row).get_value(row % block_size, att_idx);
+}
+
+int columnar_store::get_label(size_t idx) const {
+    long row = find_row(idx);
+    return block_of(row).get_label(row % block_size);
+}
+
+void columnar_store::materialize(size_t idx, DenseInstance& view) const {
+    long row = find_row(idx);
+    const column_block& block = block_of(row);
+    int block_row = row % block_size;
+    int num_attributes = block.get_num_attributes();
+
+    view.mInputData.resize(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        view.mInputData[i] = block.get_value(block_row, i);
+    }
+    view.mOutputData.assign(1, (double) block.get_label(block_row));
+    view.setInstanceInformation(instance_information);
+    view.setWeight(1);
+}
+
+long columnar_store::get_memory_bytes(set<const void*>& counted) const {
+    long bytes = sizeof(columnar_store)
+                 + runs.capacity() * sizeof(run)
+                 + blocks.capacity() * sizeof(shared_ptr<column_block>);
+    for (auto& block : blocks) {
+        if (block != nullptr && counted.insert(block.get()).second) {
+            bytes += block->get_memory_bytes();
+        }
+    }
+    return bytes;
+}
+
+void columnar_store::collect_blocks(std::map<long, shared_ptr<column_block>>& block_table) const {
+    for (int i = 0; i < blocks.size(); i++) {
+        if (blocks[i] != nullptr) {
+            block_table[first_block_idx + i] = blocks[i];
+        }
+    }
+}
+
+void columnar_store::write_runs(string& buffer) const {
+    write_value<int>(buffer, runs.size());
+    for (auto& cur_run : runs) {
+        write_value<long>(buffer, cur_run.start);
+        write_value<long>(buffer, cur_run.count);
+    }
+}
+
+void columnar_store::read_runs(const string& buffer,
+                               size_t& pos,
+                               const std::map<long, shared_ptr<column_block>>& block_table,
+                               int block_size,
+                               InstanceInformation* instance_information) {
+    this->block_size = block_size;
+    this->instance_information = instance_information;
+    runs.clear();
+    blocks.clear();
+    first_block_idx = -1;
+    num_rows = 0;
+
+    int num_runs = read_value<int>(buffer, pos);
+    for (int i = 0; i < num_runs; i++) {
+        run cur_run;
+        cur_run.start = read_value<long>(buffer, pos);
+        cur_run.count = read_value<long>(buffer, pos);
+        runs.push_back(cur_run);
+
+        long last_row = cur_run.start + cur_run.count - 1;
+        for (long block_idx = cur_run.start / block_size; block_idx <= last_row / block_size; block_idx++) {
+            auto entry = block_table.find(block_idx);
+            if (entry == block_table.end()) {
+                cout << "columnar_store: missing block " << block_idx << endl;
+                exit(1);
+            }
+            attach_block(block_idx, entry->second);
+        }
+        num_rows += cur_run.count;
+    }
+}
+
+long columnar_store::get_end_row() const {
+    if (runs.empty()) {
+        return 0;
+    }
+    return runs.back().start + runs.back().count;
+}
+
+void columnar_store::spill(spill_file& file, value_encoding_enum encoding) {
+    if (is_spilled() || empty()) {
+        return;
+    }
+
+    std::map<long, shared_ptr<column_block>> block_table;
+    collect_blocks(block_table);
+
+    string bytes;
+    write_value<int>(bytes, block_table.size());
+    for (auto& entry : block_table) {
+        write_value<long>(bytes, entry.first);
+        entry.second->write_to(bytes, encoding);
+    }
+
+    spilled_extent = file.append(bytes);
+    blocks.clear();
+    blocks.shrink_to_fit();
+}
+
+bool columnar_store::is_spilled() const {
+    return spilled_extent != nullptr;
+}
+
+columnar_store columnar_store::load_resident() const {
+    columnar_store resident = *this;
+    if (!is_spilled()) {
+        return resident;
+    }
+    resident.spilled_extent = nullptr;
+
+    string bytes = spilled_extent->read();
+    size_t pos = 0;
+    int num_blocks = read_value<int>(bytes, pos);
+    for (int i = 0; i < num_blocks; i++) {
+        long block_idx = read_value<long>(bytes, pos);
+        resident.attach_block(block_idx, column_block::read_from(bytes, pos, block_size));
+    }
+    return resident;
+}
@@ -0,0 +1,153 @@
+#ifndef COLUMNAR_STORE_H
+#define COLUMNAR_STORE_H
+
+#include <cstdint>
+#include <set>
+
+#include <streamDM/streams/ArffReader.h>
+
+#include "tree_serialization.h"
+#include "spill_file.h"
+
+enum class value_encoding_enum { float64_encoding, float32_encoding, uint16_encoding, uint8_encoding };
+value_encoding_enum parse_value_encoding(const string& encoding_str);
+
+// Up to block_size instances stored column by column.
+// While open, rows are appended as raw doubles. When the block fills up it
+// is sealed: each attribute column is re-encoded on its own with a
+// block-local affine map value = offset + code * scale.
+// Integer-valued columns (nominal attributes, counts) whose range fits into
+// 8 or 16 bits are always stored losslessly in that width, other columns use
+// the requested encoding. Labels take one byte per row.
+class column_block {
+public:
+    column_block(int num_attributes, int block_size);
+
+    void append(Instance& instance);
+    void seal(value_encoding_enum encoding);
+
+    bool is_full() const;
+    int size() const;
+    int get_num_attributes() const;
+    double get_value(int row, int att_idx) const;
+    int get_label(int row) const;
+    long get_memory_bytes() const;
+
+    // sealed form, an open block is encoded on the fly
+    void write_to(string& buffer, value_encoding_enum encoding) const;
+    static unique_ptr<column_block> read_from(const string& buffer, size_t& pos, int block_size);
+
+private:
+    struct column {
+        value_encoding_enum encoding = value_encoding_enum::float64_encoding;
+        double offset = 0;
+        double scale = 1;
+        vector<uint8_t> codes;
+    };
+
+    int num_attributes;
+    int block_size;
+    int num_rows = 0;
+    bool sealed = false;
+
+    vector<double> open_values; // row-major while the block is open
+    vector<uint8_t> labels;
+    vector<column> columns;
+
+    column encode_column(int att_idx, value_encoding_enum encoding) const;
+    static double decode_value(const column& cur_column, int row);
+};
+
+// Append-only log of the instances retained by one learner.
+// Instances are appended once, however many trees keep them, and addressed
+// by a global row id. Blocks are aligned to multiples of block_size rows.
+// The log itself only holds the open block: sealed blocks are owned by the
+// tree stores that cover them and are freed with the last of those stores.
+class instance_log {
+public:
+    explicit instance_log(int block_size = 256);
+
+    void set_encoding(value_encoding_enum encoding);
+    value_encoding_enum get_encoding() const;
+    int get_block_size() const;
+    InstanceInformation* get_instance_information() const;
+
+    // returns the row id
+    long append(Instance& instance);
+    // the block holding the most recently appended row
+    shared_ptr<column_block> get_open_block() const;
+    // release the open block, numbering continues at the next block boundary
+    void close_block();
+
+    long get_memory_bytes(set<const void*>& counted) const;
+
+private:
+    int block_size;
+    value_encoding_enum encoding = value_encoding_enum::float64_encoding;
+    long num_rows = 0;
+    int num_attributes = -1;
+    InstanceInformation* instance_information = nullptr;
+    shared_ptr<column_block> open_block;
+};
+
+// A tree's view of the learner's instance_log.
+// Rows are kept as runs of consecutive log rows, so a tree that stores every
+// instance since its creation costs one run no matter how many rows it holds.
+// Rows are addressed by local index and read in place or materialized into a
+// caller-owned DenseInstance, so stored rows never alias live stream instances.
+class columnar_store {
+public:
+    columnar_store() = default;
+
+    void append(instance_log& log, long row);
+    size_t size() const;
+    bool empty() const;
+    int get_num_attributes() const;
+
+    double get_value(size_t idx, int att_idx) const;
+    int get_label(size_t idx) const;
+    // the view is overwritten on each call and only valid until the next one
+    void materialize(size_t idx, DenseInstance& view) const;
+
+    // blocks shared with other stores are counted once
+    long get_memory_bytes(set<const void*>& counted) const;
+
+    // blocks are written to a table shared by all stores of a learner
+    void collect_blocks(std::map<long, shared_ptr<column_block>>& block_table) const;
+    void write_runs(string& buffer) const;
+    void read_runs(const string& buffer,
+                   size_t& pos,
+                   const std::map<long, shared_ptr<column_block>>& block_table,
+                   int block_size,
+                   InstanceInformation* instance_information);
+    long get_end_row() const;
+
+    // out of core: the blocks are written to the spill file and dropped, the
+    // runs stay in memory. A spilled store cannot be read or appended to, a
+    // resident copy is loaded for that.
+    void spill(spill_file& file, value_encoding_enum encoding);
+    bool is_spilled() const;
+    // shares this store's blocks, or reads them back from the spill file
+    columnar_store load_resident() const;
+
+private:
+    struct run {
+        long start;
+        long count;
+    };
+
+    int block_size = 0;
+    size_t num_rows = 0;
+    InstanceInformation* instance_information = nullptr;
+    vector<run> runs;
+    // blocks[i] holds log block first_block_idx + i, null where no run reaches
+    long first_block_idx = -1;
+    vector<shared_ptr<column_block>> blocks;
+    shared_ptr<spill_file::extent> spilled_extent;
+
+    long find_row(size_t idx) const;
+    const column_block& block_of(long row) const;
+    void attach_block(long block_idx, shared_ptr<column_block> block);
+};
+
+#endif //COLUMNAR_STORE_H
@@ -0,0 +1,1223 @@
+#include "compact_hoeffding_tree.h"
+
+namespace {
+
+double entropy(const double* weights, int count) {
+    double total = 0;
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        if (weights[i] > 0) {
+            total += weights[i];
+            sum -= weights[i] * log2(weights[i]);
+        }
+    }
+    if (total <= 0) {
+        return 0;
+    }
+    return (sum + total * log2(total)) / total;
+}
+
+double sum_weights(const double* weights, int count) {
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        total += weights[i];
+    }
+    return total;
+}
+
+template <typename T>
+void write_array(string& buffer, const T* values, int count) {
+    buffer.append((const char*) values, count * sizeof(T));
+}
+
+template <typename T>
+void read_array(const string& buffer, size_t& pos, T* values, int count) {
+    size_t bytes = count * sizeof(T);
+    if (pos + bytes > buffer.size()) {
+        cout << "compact_hoeffding_tree: truncated buffer" << endl;
+        exit(1);
+    }
+    memcpy(values, buffer.data() + pos, bytes);
+    pos += bytes;
+}
+
+}
+
+compact_hoeffding_tree::compact_hoeffding_tree() = default;
+
+compact_hoeffding_tree::compact_hoeffding_tree(const compact_hoeffding_tree& rhs) :
+        grace_period(rhs.grace_period),
+        split_confidence(rhs.split_confidence),
+        tie_threshold(rhs.tie_threshold),
+        num_split_points(rhs.num_split_points),
+        min_branch_fraction(rhs.min_branch_fraction),
+        num_bins(rhs.num_bins),
+        adaptive_grace_period(rhs.adaptive_grace_period),
+        num_split_attempts(rhs.num_split_attempts),
+        num_split_attempts_saved(rhs.num_split_attempts_saved),
+        memory_budget(rhs.memory_budget),
+        instances_since_check(rhs.instances_since_check),
+        remove_poor_attributes(rhs.remove_poor_attributes),
+        scheduler(rhs.scheduler),
+        vertical_workers(rhs.vertical_workers),
+        min_parallel_attributes(rhs.min_parallel_attributes),
+        num_attributes(rhs.num_attributes),
+        num_classes(rhs.num_classes),
+        num_nodes(rhs.num_nodes),
+        num_leaves(rhs.num_leaves),
+        num_active_leaves(rhs.num_active_leaves) {
+
+    if (rhs.root != nullptr) {
+        values.resize(num_attributes);
+        free_stats.resize(num_attributes + 1, nullptr);
+        root = copy_subtree(rhs.root);
+        if (rhs.shared_log != nullptr) {
+            root->stats = replay_shared_rows(*rhs.shared_log, rhs.shared_first_row, rhs.shared_weights);
+            root->stats->weight_at_last_eval = rhs.shared_weight_at_last_eval;
+            root->stats->eval_delay = rhs.shared_eval_delay;
+        }
+    }
+}
+
+compact_hoeffding_tree::~compact_hoeffding_tree() {
+    if (pending != nullptr) {
+        pending->task->wait();
+    }
+    if (shared_log != nullptr) {
+        shared_log->detach(shared_first_row);
+    }
+}
+
+unique_ptr<compact_hoeffding_tree> compact_hoeffding_tree::clone_settings() const {
+    unique_ptr<compact_hoeffding_tree> tree = make_unique<compact_hoeffding_tree>();
+    tree->grace_period = grace_period;
+    tree->split_confidence = split_confidence;
+    tree->tie_threshold = tie_threshold;
+    tree->num_split_points = num_split_points;
+    tree->min_branch_fraction = min_branch_fraction;
+    tree->num_bins = num_bins;
+    tree->adaptive_grace_period = adaptive_grace_period;
+    tree->memory_budget = memory_budget;
+    tree->scheduler = scheduler;
+    tree->vertical_workers = vertical_workers;
+    tree->min_parallel_attributes = min_parallel_attributes;
+    return tree;
+}
+
+void compact_hoeffding_tree::set_num_bins(int num_bins) {
+    if (root != nullptr) {
+        cout << "set_num_bins: the tree has been trained already" << endl;
+        exit(1);
+    }
+    if (num_bins != 0 && (num_bins < 2 || num_bins > UINT8_MAX + 1)) {
+        cout << "set_num_bins: num_bins must be 0 or within [2, 256]" << endl;
+        exit(1);
+    }
+    this->num_bins = num_bins;
+}
+
+int compact_hoeffding_tree::get_num_bins() const {
+    return num_bins;
+}
+
+void compact_hoeffding_tree::set_adaptive_grace_period(bool enabled) {
+    adaptive_grace_period = enabled;
+}
+
+long compact_hoeffding_tree::get_num_split_attempts() const {
+    return num_split_attempts;
+}
+
+long compact_hoeffding_tree::get_num_split_attempts_saved() const {
+    return num_split_attempts_saved;
+}
+
+void compact_hoeffding_tree::set_split_scheduler(shared_ptr<split_scheduler> scheduler) {
+    finish_pending_split();
+    this->scheduler = std::move(scheduler);
+}
+
+void compact_hoeffding_tree::set_attribute_workers(shared_ptr<attribute_workers> workers, int min_attributes) {
+    finish_pending_split();
+    vertical_workers = std::move(workers);
+    min_parallel_attributes = min_attributes;
+}
+
+void compact_hoeffding_tree::set_memory_budget(long budget_bytes) {
+    memory_budget = std::max(budget_bytes, 0L);
+}
+
+long compact_hoeffding_tree::get_memory_budget() const {
+    return memory_budget;
+}
+
+void compact_hoeffding_tree::init_schema(int num_attributes, int num_classes) {
+    this->num_attributes = num_attributes;
+    this->num_classes = num_classes;
+    values.resize(num_attributes);
+    free_stats.resize(num_attributes + 1, nullptr);
+
+    root = new_node();
+    if (shared_log == nullptr) {
+        root->stats = acquire_full_stats();
+    }
+    num_nodes = 1;
+    num_leaves = 1;
+    num_active_leaves = 1;
+}
+
+compact_hoeffding_tree::node* compact_hoeffding_tree::new_node() {
+    node* cur = arena.allocate<node>();
+    cur->split_att = -1;
+    cur->class_weights = arena.allocate<double>(num_classes);
+    return cur;
+}
+
+long compact_hoeffding_tree::get_node_bytes() const {
+    return sizeof(node) + num_classes * sizeof(double);
+}
+
+int compact_hoeffding_tree::get_observer_width() const {
+    return num_bins > 0 ? num_bins + 1 : num_observer_stats;
+}
+
+long compact_hoeffding_tree::get_stats_bytes(int num_tracked) const {
+    return sizeof(leaf_stats)
+           + num_tracked * sizeof(int)
+           + num_classes * get_observer_width() * num_tracked * sizeof(double);
+}
+
+compact_hoeffding_tree::leaf_stats* compact_hoeffding_tree::acquire_stats(int num_tracked) {
+    int observer_size = num_classes * get_observer_width() * num_tracked;
+    leaf_stats* stats = free_stats[num_tracked];
+    if (stats != nullptr) {
+        free_stats[num_tracked] = stats->next_free;
+        int* tracked_atts = stats->tracked_atts;
+        double* observers = stats->observers;
+        memset(stats, 0, sizeof(leaf_stats));
+        memset(observers, 0, observer_size * sizeof(double));
+        stats->tracked_atts = tracked_atts;
+        stats->observers = observers;
+    } else {
+        stats = arena.allocate<leaf_stats>();
+        stats->tracked_atts = arena.allocate<int>(num_tracked);
+        stats->observers = arena.allocate<double>(observer_size);
+    }
+    stats->num_tracked = num_tracked;
+    if (num_bins > 0) {
+        live_stats_bytes += get_stats_bytes(num_tracked);
+        return stats;
+    }
+
+    for (int label = 0; label < num_classes; label++) {
+        double* block = observer_block(stats, label);
+        std::fill(block + 3 * num_tracked, block + 4 * num_tracked, numeric_limits<double>::infinity());
+        std::fill(block + 4 * num_tracked, block + 5 * num_tracked, -numeric_limits<double>::infinity());
+    }
+    live_stats_bytes += get_stats_bytes(num_tracked);
+    return stats;
+}
+
+compact_hoeffding_tree::leaf_stats* compact_hoeffding_tree::acquire_full_stats() {
+    leaf_stats* stats = acquire_stats(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        stats->tracked_atts[i] = i;
+    }
+    return stats;
+}
+
+void compact_hoeffding_tree::release_stats(leaf_stats* stats) {
+    live_stats_bytes -= get_stats_bytes(stats->num_tracked);
+    stats->next_free = free_stats[stats->num_tracked];
+    free_stats[stats->num_tracked] = stats;
+}
+
+compact_hoeffding_tree::leaf_stats* compact_hoeffding_tree::replay_shared_rows(const shared_observation_log& log,
+                                                                             long first_row,
+                                                                             const vector<uint8_t>& weights) {
+    leaf_stats* stats = acquire_full_stats();
+    vector<double> class_weights(num_classes, 0);
+    node replayed_root = {};
+    replayed_root.split_att = -1;
+    replayed_root.class_weights = class_weights.data();
+    replayed_root.stats = stats;
+
+    // the rows are trained in order, as train_leaf does on a private root
+    for (size_t i = 0; i < weights.size(); i++) {
+        if (weights[i] == 0) {
+            continue;
+        }
+        int label = log.get_label(first_row + i);
+        const double* row_values = log.get_values(first_row + i);
+        if (predict_majority(&replayed_root) == label) {
+            stats->mc_correct_weight += weights[i];
+        }
+        if (predict_naive_bayes(&replayed_root, row_values) == label) {
+            stats->nb_correct_weight += weights[i];
+        }
+        class_weights[label] += weights[i];
+        update_observers(stats, label, row_values, weights[i]);
+    }
+    return stats;
+}
+
+double* compact_hoeffding_tree::observer_block(const leaf_stats* stats, int label) const {
+    return stats->observers + label * get_observer_width() * stats->num_tracked;
+}
+
+compact_hoeffding_tree::node* compact_hoeffding_tree::find_leaf(node* cur, const double* values) const {
+    while (cur->split_att >= 0) {
+        cur = values[cur->split_att] <= cur->split_value ? cur->left : cur->right;
+    }
+    return cur;
+}
+
+void compact_hoeffding_tree::train(const Instance& instance, double weight) {
+    // streamDM getters are not const-qualified, nothing is written through this reference
+    Instance& source = const_cast<Instance&>(instance);
+    if (weight <= 0) {
+        return;
+    }
+    finish_pending_split();
+    if (root == nullptr) {
+        init_schema(source.getNumberInputAttributes(), source.getNumberClasses());
+    }
+
+    int label = source.getLabel();
+    if (label < 0 || label >= num_classes) {
+        cout << "compact_hoeffding_tree: label " << label << " out of range" << endl;
+        exit(1);
+    }
+    if (shared_log != nullptr) {
+        if (can_share(instance, weight)) {
+            train_shared_root(label, weight);
+            return;
+        }
+        unshare_root();
+    }
+
+    for (int i = 0; i < num_attributes; i++) {
+        values[i] = source.getInputAttributeValue(i);
+    }
+
+    node* leaf = find_leaf(root, values.data());
+    if (train_leaf(leaf, label, values.data(), weight)) {
+        if (scheduler != nullptr) {
+            schedule_split(leaf);
+        } else {
+            attempt_split(leaf);
+        }
+    }
+
+    if (memory_budget > 0 && ++instances_since_check >= memory_check_period) {
+        instances_since_check = 0;
+        finish_pending_split();
+        enforce_memory_budget();
+    }
+}
+
+void compact_hoeffding_tree::train_batch(const vector<const Instance*>& instances, const vector<double>& weights) {
+    if (instances.size() != weights.size()) {
+        cout << "train_batch: instances and weights differ in length" << endl;
+        exit(1);
+    }
+    size_t next = 0;
+    while (next < instances.size() && (root == nullptr || shared_log != nullptr)) {
+        train(*instances[next], weights[next]);
+        next++;
+    }
+
+    // leaves are split inline, a later instance of the batch may reach them
+    finish_pending_split();
+    while (next < instances.size()) {
+        next = train_grouped(instances, weights, next);
+    }
+}
+
+bool compact_hoeffding_tree::train_leaf(node* leaf, int label, const double* values, double weight) {
+    leaf_stats* stats = leaf->stats;
+    if (stats != nullptr) {
+        if (predict_majority(leaf) == label) {
+            stats->mc_correct_weight += weight;
+        }
+        if (predict_naive_bayes(leaf, values) == label) {
+            stats->nb_correct_weight += weight;
+        }
+    }
+
+    leaf->class_weights[label] += weight;
+    if (stats == nullptr) {
+        return false;
+    }
+    update_observers(stats, label, values, weight);
+
+    double weight_seen = sum_weights(leaf->class_weights, num_classes);
+    return is_split_due(weight_seen - stats->weight_at_last_eval, stats->eval_delay);
+}
+
+size_t compact_hoeffding_tree::train_grouped(const vector<const Instance*>& instances,
+                                             const vector<double>& weights,
+                                             size_t begin) {
+    long max_rows = memory_budget > 0 ? memory_check_period - instances_since_check : numeric_limits<long>::max();
+    batch_values.clear();
+    batch_labels.clear();
+    batch_weights.clear();
+    routed_rows.clear();
+
+    size_t end = begin;
+    for (; end < instances.size() && (long) routed_rows.size() < max_rows; end++) {
+        if (weights[end] <= 0) {
+            continue;
+        }
+        Instance& source = const_cast<Instance&>(*instances[end]);
+        int label = source.getLabel();
+        if (label < 0 || label >= num_classes) {
+            cout << "compact_hoeffding_tree: label " << label << " out of range" << endl;
+            exit(1);
+        }
+
+        int row = routed_rows.size();
+        batch_values.resize((row + 1) * num_attributes);
+        double* row_values = batch_values.data() + row * num_attributes;
+        for (int i = 0; i < num_attributes; i++) {
+            row_values[i] = source.getInputAttributeValue(i);
+        }
+        batch_labels.push_back(label);
+        batch_weights.push_back(weights[end]);
+        routed_rows.emplace_back(find_leaf(root, row_values), row);
+    }
+
+    // rows of one leaf stay in batch order; std::sort needs no buffer, unlike stable_sort
+    std::sort(routed_rows.begin(), routed_rows.end(),
+              [](const std::pair<node*, int>& lhs, const std::pair<node*, int>& rhs) {
+                  if (lhs.first != rhs.first) {
+                      return std::less<node*>()(lhs.first, rhs.first);
+                  }
+                  return lhs.second < rhs.second;
+              });
+    for (auto& routed_row : routed_rows) {
+        int row = routed_row.second;
+        const double* row_values = batch_values.data() + row * num_attributes;
+        // descends below a leaf that split earlier in the batch
+        node* leaf = find_leaf(routed_row.first, row_values);
+        if (train_leaf(leaf, batch_labels[row], row_values, batch_weights[row])) {
+            attempt_split(leaf);
+        }
+    }
+
+    if (memory_budget > 0) {
+        instances_since_check += routed_rows.size();
+        if (instances_since_check >= memory_check_period) {
+            instances_since_check = 0;
+            enforce_memory_budget();
+        }
+    }
+    return end;
+}
+
+void compact_hoeffding_tree::share_root(shared_ptr<shared_observation_log> log) {
+    if (root != nullptr || shared_log != nullptr) {
+        cout << "share_root: only an untrained tree can share its root" << endl;
+        exit(1);
+    }
+    shared_log = std::move(log);
+    shared_first_row = shared_log->get_end_row();
+    shared_log->attach(shared_first_row);
+}
+
+bool compact_hoeffding_tree::is_root_shared() const {
+    return shared_log != nullptr;
+}
+
+void compact_hoeffding_tree::unshare_root() {
+    if (shared_log == nullptr) {
+        return;
+    }
+    if (root != nullptr) {
+        root->stats = replay_shared_rows(*shared_log, shared_first_row, shared_weights);
+        root->stats->weight_at_last_eval = shared_weight_at_last_eval;
+        root->stats->eval_delay = shared_eval_delay;
+    }
+    leave_shared_log();
+}
+
+bool compact_hoeffding_tree::can_share(const Instance& instance, double weight) const {
+    long num_rows = shared_log->get_end_row() - shared_first_row;
+    if (&instance != shared_log->get_last_instance()
+        || shared_weights.size() >= num_rows
+        || weight != floor(weight)
+        || weight > UINT8_MAX) {
+        return false;
+    }
+
+    long log_share = shared_log->get_row_bytes() / std::max(shared_log->get_num_attached(), 1);
+    return num_rows * (1 + log_share) <= get_stats_bytes(num_attributes);
+}
+
+// The observers only exist while a split is attempted or the naive Bayes
+// weight is recounted, so a split is decided on the same statistics a
+// private root would have. A shared root predicts the majority class, which
+// holds while naive Bayes cannot have been right more often; once it may
+// have, the rows are recounted and the root goes private if it was.
+void compact_hoeffding_tree::train_shared_root(int label, double weight) {
+    shared_weights.resize(shared_log->get_end_row() - shared_first_row, 0);
+    shared_weights.back() = (uint8_t) weight;
+    if (predict_majority(root) == label) {
+        shared_mc_correct_weight += weight;
+    }
+    shared_unchecked_weight += weight;
+    root->class_weights[label] += weight;
+
+    double weight_seen = sum_weights(root->class_weights, num_classes);
+    bool split_due = is_split_due(weight_seen - shared_weight_at_last_eval, shared_eval_delay);
+    bool recount_due = shared_nb_correct_weight + shared_unchecked_weight > shared_mc_correct_weight;
+    if (!split_due && !recount_due) {
+        return;
+    }
+
+    long num_rows = shared_weights.size();
+    root->stats = replay_shared_rows(*shared_log, shared_first_row, shared_weights);
+    root->stats->weight_at_last_eval = shared_weight_at_last_eval;
+    root->stats->eval_delay = shared_eval_delay;
+    if (split_due) {
+        attempt_split(root);
+        if (root->split_att >= 0) {
+            leave_shared_log();
+            return;
+        }
+        shared_eval_delay = root->stats->eval_delay;
+        shared_weight_at_last_eval = weight_seen;
+    }
+
+    if (root->stats->nb_correct_weight > root->stats->mc_correct_weight
+        || (recount_due && (num_rows - shared_counted_rows) * shared_recount_ratio < num_rows)) {
+        leave_shared_log();
+        return;
+    }
+    shared_nb_correct_weight = root->stats->nb_correct_weight;
+    shared_unchecked_weight = 0;
+    shared_counted_rows = num_rows;
+    release_stats(root->stats);
+    root->stats = nullptr;
+}
+
+void compact_hoeffding_tree::leave_shared_log() {
+    shared_log->detach(shared_first_row);
+    shared_log = nullptr;
+    shared_weights.clear();
+    shared_weights.shrink_to_fit();
+}
+
+bool compact_hoeffding_tree::is_attribute_parallel(int num_tracked) const {
+    return vertical_workers != nullptr && num_tracked >= min_parallel_attributes;
+}
+
+// weighted Welford update of one class's observers over the tracked attributes
+void compact_hoeffding_tree::update_observers(leaf_stats* stats, int label, const double* values, double weight) {
+    int num_tracked = stats->num_tracked;
+    double* block = observer_block(stats, label);
+    if (is_attribute_parallel(num_tracked)
+        && vertical_workers->try_run(num_tracked, [&](int, int begin, int end) {
+               update_observer_columns(stats, block, values, weight, begin, end);
+           })) {
+        return;
+    }
+    update_observer_columns(stats, block, values, weight, 0, num_tracked);
+}
+
+// columns begin .. end-1 are independent of the others in every array
+void compact_hoeffding_tree::update_observer_columns(const leaf_stats* stats,
+                                                     double* block,
+                                                     const double* values,
+                                                     double weight,
+                                                     int begin,
+                                                     int end) {
+    int num_tracked = stats->num_tracked;
+    const int* tracked_atts = stats->tracked_atts;
+    if (num_bins > 0) {
+        update_histograms(end - begin, tracked_atts + begin, block + begin * (num_bins + 1), values, weight);
+        return;
+    }
+
+    // a leaf observing every attribute tracks them in order
+    bool in_order = num_tracked == num_attributes;
+    update_gaussian_observers(end - begin,
+                              in_order ? nullptr : tracked_atts + begin,
+                              in_order ? values + begin : values,
+                              weight,
+                              block + begin,
+                              block + num_tracked + begin,
+                              block + 2 * num_tracked + begin,
+                              block + 3 * num_tracked + begin,
+                              block + 4 * num_tracked + begin);
+}
+
+// one bin count per attribute, then the column's total
+void compact_hoeffding_tree::update_histograms(int num_tracked,
+                                               const int* tracked_atts,
+                                               double* block,
+                                               const double* values,
+                                               double weight) const {
+    int width = num_bins + 1;
+    for (int i = 0; i < num_tracked; i++) {
+        double value = values[tracked_atts[i]];
+        if (std::isnan(value)) {
+            continue;
+        }
+        double* histogram = block + i * width;
+        histogram[get_bin(value)] += weight;
+        histogram[num_bins] += weight;
+    }
+}
+
+int compact_hoeffding_tree::get_bin(double value) const {
+    return std::min(std::max((int) value, 0), num_bins - 1);
+}
+
+int compact_hoeffding_tree::predict(Instance& instance) const {
+    if (root == nullptr) {
+        return 0;
+    }
+
+    static thread_local vector<double> predict_values;
+    predict_values.resize(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        predict_values[i] = instance.getInputAttributeValue(i);
+    }
+
+    const node* leaf = find_leaf(root, predict_values.data());
+    if (leaf->stats != nullptr && leaf->stats->nb_correct_weight > leaf->stats->mc_correct_weight) {
+        return predict_naive_bayes(leaf, predict_values.data());
+    }
+    return predict_majority(leaf);
+}
+
+int compact_hoeffding_tree::predict_majority(const node* leaf) const {
+    return std::max_element(leaf->class_weights, leaf->class_weights + num_classes) - leaf->class_weights;
+}
+
+int compact_hoeffding_tree::predict_naive_bayes(const node* leaf, const double* values) const {
+    double total = sum_weights(leaf->class_weights, num_classes);
+    if (total <= 0) {
+        return 0;
+    }
+
+    int num_tracked = leaf->stats->num_tracked;
+    const int* tracked_atts = leaf->stats->tracked_atts;
+    int result = 0;
+    double max_log_prob = -numeric_limits<double>::infinity();
+    for (int label = 0; label < num_classes; label++) {
+        if (leaf->class_weights[label] <= 0) {
+            continue;
+        }
+
+        const double* block = observer_block(leaf->stats, label);
+        double log_prob = log(leaf->class_weights[label] / total);
+        if (num_bins > 0) {
+            log_prob += histogram_log_likelihood(num_tracked, tracked_atts, block, values);
+        } else {
+            log_prob += gaussian_log_likelihood(num_tracked, tracked_atts, block, values);
+        }
+
+        if (log_prob > max_log_prob) {
+            max_log_prob = log_prob;
+            result = label;
+        }
+    }
+    return result;
+}
+
+double compact_hoeffding_tree::gaussian_log_likelihood(int num_tracked,
+                                                       const int* tracked_atts,
+                                                       const double* block,
+                                                       const double* values) const {
+    double log_prob = 0;
+    for (int i = 0; i < num_tracked; i++) {
+        double weight = block[i];
+        if (weight <= 0) {
+            continue;
+        }
+        double value = values[tracked_atts[i]];
+        double mean = block[num_tracked + i];
+        double variance = weight > 1 ? block[2 * num_tracked + i] / (weight - 1) : 0;
+        double prob;
+        if (variance > 0) {
+            double diff = value - mean;
+            prob = exp(-diff * diff / (2 * variance)) / sqrt(2 * M_PI * variance);
+        } else {
+            prob = value == mean ? 1 : 0;
+        }
+        log_prob += log(std::max(prob, 1e-300));
+    }
+    return log_prob;
+}
+
+// Laplace-smoothed bin frequencies
+double compact_hoeffding_tree::histogram_log_likelihood(int num_tracked,
+                                                        const int* tracked_atts,
+                                                        const double* block,
+                                                        const double* values) const {
+    double log_prob = 0;
+    for (int i = 0; i < num_tracked; i++) {
+        double value = values[tracked_atts[i]];
+        if (std::isnan(value)) {
+            continue;
+        }
+        const double* histogram = block + i * (num_bins + 1);
+        log_prob += log((histogram[get_bin(value)] + 1) / (histogram[num_bins] + num_bins));
+    }
+    return log_prob;
+}
+
+void compact_hoeffding_tree::attempt_split(node* leaf) {
+    split_decision decision;
+    evaluate_split(leaf, decision);
+    apply_split_decision(leaf, decision);
+}
+
+void compact_hoeffding_tree::evaluate_split(const node* leaf, split_decision& decision) const {
+    double weight_seen = sum_weights(leaf->class_weights, num_classes);
+    decision.weight_seen = weight_seen;
+
+    int num_observed_classes = 0;
+    for (int label = 0; label < num_classes; label++) {
+        if (leaf->class_weights[label] > 0) {
+            num_observed_classes++;
+        }
+    }
+    if (num_observed_classes < 2) {
+        return;
+    }
+    decision.attempted = true;
+
+    int num_tracked = leaf->stats->num_tracked;
+    vector<double> merits(num_tracked);
+    vector<split_candidate> candidates(1);
+    if (is_attribute_parallel(num_tracked)) {
+        candidates.resize(vertical_workers->get_num_partitions());
+        if (!vertical_workers->try_run(num_tracked, [&](int partition, int begin, int end) {
+                evaluate_columns(leaf, begin, end, merits, candidates[partition]);
+            })) {
+            candidates.resize(1);
+        }
+    }
+    if (candidates.size() == 1) {
+        evaluate_columns(leaf, 0, num_tracked, merits, candidates[0]);
+    }
+
+    // not splitting has merit 0 and competes with the attributes. Taking the
+    // partitions in column order keeps the first of equal merits.
+    int best_att = -1;
+    double best_merit = 0;
+    double best_value = 0;
+    double second_merit = -numeric_limits<double>::infinity();
+    vector<double> best_weights;
+    for (split_candidate& candidate : candidates) {
+        if (candidate.merit > best_merit) {
+            second_merit = best_merit;
+            best_merit = candidate.merit;
+            best_att = leaf->stats->tracked_atts[candidate.column];
+            best_value = candidate.value;
+            best_weights = std::move(candidate.branch_weights);
+        } else if (candidate.merit > second_merit) {
+            second_merit = candidate.merit;
+        }
+        second_merit = std::max(second_merit, candidate.second_merit);
+    }
+
+    double range = log2(std::max(num_classes, 2));
+    double hoeffding_bound = sqrt(range * range * log(1.0 / split_confidence) / (2 * weight_seen));
+    if (best_att >= 0 && (best_merit - second_merit > hoeffding_bound || hoeffding_bound < tie_threshold)) {
+        decision.split = true;
+        decision.att = best_att;
+        decision.value = best_value;
+        decision.branch_weights = std::move(best_weights);
+        return;
+    }
+
+    for (int i = 0; i < num_tracked; i++) {
+        if (std::isinf(merits[i]) || best_merit - merits[i] <= hoeffding_bound) {
+            decision.kept_columns.push_back(i);
+        }
+    }
+
+    // the bound falls below the current gap, or the tie threshold, at
+    // split_weight; the gap rarely widens fast enough to split earlier
+    double margin = std::max(best_att >= 0 ? best_merit - second_merit : 0, tie_threshold);
+    decision.split_weight = range * range * log(1.0 / split_confidence) / (2 * margin * margin);
+}
+
+void compact_hoeffding_tree::apply_split_decision(node* leaf, const split_decision& decision) {
+    if (!decision.attempted) {
+        leaf->stats->eval_delay = 0;
+        leaf->stats->weight_at_last_eval = decision.weight_seen;
+        return;
+    }
+
+    num_split_attempts++;
+    if (leaf->stats->eval_delay > grace_period) {
+        num_split_attempts_saved += (long) (leaf->stats->eval_delay / grace_period) - 1;
+    }
+
+    if (decision.split) {
+        apply_split(leaf, decision.att, decision.value, decision.branch_weights);
+        return;
+    }
+
+    const vector<int>& kept_columns = decision.kept_columns;
+    if (remove_poor_attributes && !kept_columns.empty() && kept_columns.size() < leaf->stats->num_tracked) {
+        drop_columns(leaf, kept_columns);
+    }
+    if (adaptive_grace_period) {
+        leaf->stats->eval_delay = decision.split_weight - decision.weight_seen;
+    }
+    leaf->stats->weight_at_last_eval = decision.weight_seen;
+}
+
+// the leaf is not trained until the decision is applied, so the worker
+// reads statistics nothing else writes
+void compact_hoeffding_tree::schedule_split(node* leaf) {
+    pending = make_unique<pending_split>();
+    pending->leaf = leaf;
+    pending_split* split = pending.get();
+    split->task = scheduler->submit([this, split] { evaluate_split(split->leaf, split->decision); });
+}
+
+void compact_hoeffding_tree::apply_pending_split() {
+    finish_pending_split();
+}
+
+void compact_hoeffding_tree::finish_pending_split() {
+    if (pending == nullptr) {
+        return;
+    }
+
+    pending->task->wait();
+    apply_split_decision(pending->leaf, pending->decision);
+    pending = nullptr;
+}
+
+void compact_hoeffding_tree::evaluate_columns(const node* leaf,
+                                             int begin,
+                                             int end,
+                                             vector<double>& merits,
+                                             split_candidate& candidate) const {
+    vector<double> column_weights(2 * num_classes);
+    for (int i = begin; i < end; i++) {
+        double column_value = 0;
+        merits[i] = evaluate_column(leaf, i, column_value, column_weights);
+        if (merits[i] > candidate.merit) {
+            candidate.second_merit = candidate.merit;
+            candidate.merit = merits[i];
+            candidate.column = i;
+            candidate.value = column_value;
+            candidate.branch_weights = column_weights;
+        } else if (merits[i] > candidate.second_merit) {
+            candidate.second_merit = merits[i];
+        }
+    }
+}
+
+bool compact_hoeffding_tree::is_split_due(double weight_since_eval, double eval_delay) const {
+    return weight_since_eval >= std::max((double) grace_period, eval_delay);
+}
+
+double compact_hoeffding_tree::evaluate_column(const node* leaf,
+                                               int column,
+                                               double& best_value,
+                                               vector<double>& best_weights) const {
+    if (num_bins > 0) {
+        return evaluate_histogram(leaf, column, best_value, best_weights);
+    }
+
+    int num_tracked = leaf->stats->num_tracked;
+    double min_value = numeric_limits<double>::infinity();
+    double max_value = -numeric_limits<double>::infinity();
+    for (int label = 0; label < num_classes; label++) {
+        const double* block = observer_block(leaf->stats, label);
+        if (block[column] > 0) {
+            min_value = std::min(min_value, block[3 * num_tracked + column]);
+            max_value = std::max(max_value, block[4 * num_tracked + column]);
+        }
+    }
+    if (!(min_value < max_value)) {
+        return -numeric_limits<double>::infinity();
+    }
+
+    double best_merit = -numeric_limits<double>::infinity();
+    double bin_size = (max_value - min_value) / (num_split_points + 1);
+    vector<double> branch_weights(2 * num_classes);
+    for (int split = 1; split <= num_split_points; split++) {
+        double split_value = min_value + bin_size * split;
+        for (int label = 0; label < num_classes; label++) {
+            const double* block = observer_block(leaf->stats, label);
+            double weight = block[column];
+            double mean = block[num_tracked + column];
+            double m2 = block[2 * num_tracked + column];
+            double left_weight;
+            if (weight <= 0 || split_value < block[3 * num_tracked + column]) {
+                left_weight = 0;
+            } else if (split_value >= block[4 * num_tracked + column]) {
+                left_weight = weight;
+            } else {
+                double std_dev = weight > 1 ? sqrt(m2 / (weight - 1)) : 0;
+                if (std_dev > 0) {
+                    left_weight = weight * 0.5 * erfc(-(split_value - mean) / (std_dev * M_SQRT2));
+                } else {
+                    left_weight = split_value >= mean ? weight : 0;
+                }
+            }
+            branch_weights[label] = left_weight;
+            branch_weights[num_classes + label] = weight - left_weight;
+        }
+
+        double merit = info_gain(leaf->class_weights, branch_weights.data());
+        if (merit > best_merit) {
+            best_merit = merit;
+            best_value = split_value;
+            best_weights = branch_weights;
+        }
+    }
+    return best_merit;
+}
+
+// every bin boundary is a candidate, bins at or below it go left
+double compact_hoeffding_tree::evaluate_histogram(const node* leaf,
+                                                  int column,
+                                                  double& best_value,
+                                                  vector<double>& best_weights) const {
+    int width = num_bins + 1;
+    vector<const double*> histograms(num_classes);
+    for (int label = 0; label < num_classes; label++) {
+        histograms[label] = observer_block(leaf->stats, label) + column * width;
+    }
+
+    double best_merit = -numeric_limits<double>::infinity();
+    vector<double> branch_weights(2 * num_classes, 0);
+    for (int bin = 0; bin < num_bins - 1; bin++) {
+        bool moved = false;
+        for (int label = 0; label < num_classes; label++) {
+            double bin_weight = histograms[label][bin];
+            moved = moved || bin_weight > 0;
+            branch_weights[label] += bin_weight;
+            branch_weights[num_classes + label] = histograms[label][num_bins] - branch_weights[label];
+        }
+        if (!moved) {
+            continue;
+        }
+
+        double merit = info_gain(leaf->class_weights, branch_weights.data());
+        if (merit > best_merit) {
+            best_merit = merit;
+            best_value = bin + 0.5;
+            best_weights = branch_weights;
+        }
+    }
+    return best_merit;
+}
+
+double compact_hoeffding_tree::info_gain(const double* pre_weights, const double* branch_weights) const {
+    double left_total = sum_weights(branch_weights, num_classes);
+    double right_total = sum_weights(branch_weights + num_classes, num_classes);
+    double total = left_total + right_total;
+    if (left_total <= min_branch_fraction * total || right_total <= min_branch_fraction * total) {
+        return -numeric_limits<double>::infinity();
+    }
+
+    return entropy(pre_weights, num_classes)
+           - (left_total * entropy(branch_weights, num_classes)
+              + right_total * entropy(branch_weights + num_classes, num_classes)) / total;
+}
+
+// children start from the class weights the split estimates for them
+void compact_hoeffding_tree::apply_split(node* leaf,
+                                         int att_idx,
+                                         double split_value,
+                                         const vector<double>& branch_weights) {
+    leaf->split_att = att_idx;
+    leaf->split_value = split_value;
+
+    node* children[2];
+    for (int branch = 0; branch < 2; branch++) {
+        node* child = new_node();
+        memcpy(child->class_weights, branch_weights.data() + branch * num_classes, num_classes * sizeof(double));
+        child->stats = acquire_full_stats();
+        child->stats->weight_at_last_eval = sum_weights(child->class_weights, num_classes);
+        children[branch] = child;
+    }
+    leaf->left = children[0];
+    leaf->right = children[1];
+
+    release_stats(leaf->stats);
+    leaf->stats = nullptr;
+    num_nodes += 2;
+    num_leaves++;
+    num_active_leaves++;
+}
+
+void compact_hoeffding_tree::drop_columns(node* leaf, const vector<int>& kept_columns) {
+    leaf_stats* old_stats = leaf->stats;
+    int old_num_tracked = old_stats->num_tracked;
+    int new_num_tracked = kept_columns.size();
+
+    leaf_stats* new_stats = acquire_stats(new_num_tracked);
+    new_stats->weight_at_last_eval = old_stats->weight_at_last_eval;
+    new_stats->eval_delay = old_stats->eval_delay;
+    new_stats->mc_correct_weight = old_stats->mc_correct_weight;
+    new_stats->nb_correct_weight = old_stats->nb_correct_weight;
+    for (int i = 0; i < new_num_tracked; i++) {
+        new_stats->tracked_atts[i] = old_stats->tracked_atts[kept_columns[i]];
+    }
+    for (int label = 0; label < num_classes; label++) {
+        const double* old_block = observer_block(old_stats, label);
+        double* new_block = observer_block(new_stats, label);
+        if (num_bins > 0) {
+            int width = num_bins + 1;
+            for (int i = 0; i < new_num_tracked; i++) {
+                memcpy(new_block + i * width, old_block + kept_columns[i] * width, width * sizeof(double));
+            }
+            continue;
+        }
+        for (int stat = 0; stat < num_observer_stats; stat++) {
+            for (int i = 0; i < new_num_tracked; i++) {
+                new_block[stat * new_num_tracked + i] = old_block[stat * old_num_tracked + kept_columns[i]];
+            }
+        }
+    }
+
+    release_stats(old_stats);
+    leaf->stats = new_stats;
+}
+
+// MOA's tracker limit: the most promising leaves stay active as long as
+// they fit, a deactivated leaf keeps only its class weights
+void compact_hoeffding_tree::enforce_memory_budget() {
+    vector<node*> leaves;
+    collect_leaves(root, leaves);
+
+    // promise: weight the leaf misclassifies
+    vector<std::pair<double, node*>> ranked_leaves;
+    for (node* leaf : leaves) {
+        double total = sum_weights(leaf->class_weights, num_classes);
+        double max_weight = *std::max_element(leaf->class_weights, leaf->class_weights + num_classes);
+        ranked_leaves.emplace_back(total - max_weight, leaf);
+    }
+    std::stable_sort(ranked_leaves.begin(), ranked_leaves.end(),
+                     [](const std::pair<double, node*>& lhs, const std::pair<double, node*>& rhs) {
+                         return lhs.first > rhs.first;
+                     });
+
+    long bytes = sizeof(compact_hoeffding_tree) + num_nodes * get_node_bytes();
+    bool fits = true;
+    for (auto& ranked_leaf : ranked_leaves) {
+        node* leaf = ranked_leaf.second;
+        long leaf_bytes = get_stats_bytes(leaf->stats != nullptr ? leaf->stats->num_tracked : num_attributes);
+        fits = fits && bytes + leaf_bytes <= memory_budget;
+        if (fits) {
+            bytes += leaf_bytes;
+            if (leaf->stats == nullptr) {
+                activate(leaf);
+            }
+        } else if (leaf->stats != nullptr) {
+            deactivate(leaf);
+            remove_poor_attributes = true;
+        }
+    }
+}
+
+void compact_hoeffding_tree::collect_leaves(node* cur, vector<node*>& leaves) const {
+    if (cur->split_att < 0) {
+        leaves.push_back(cur);
+        return;
+    }
+    collect_leaves(cur->left, leaves);
+    collect_leaves(cur->right, leaves);
+}
+
+void compact_hoeffding_tree::activate(node* leaf) {
+    leaf->stats = acquire_full_stats();
+    leaf->stats->weight_at_last_eval = sum_weights(leaf->class_weights, num_classes);
+    num_active_leaves++;
+}
+
+void compact_hoeffding_tree::deactivate(node* leaf) {
+    release_stats(leaf->stats);
+    leaf->stats = nullptr;
+    num_active_leaves--;
+}
+
+int compact_hoeffding_tree::get_num_nodes() const {
+    return num_nodes;
+}
+
+int compact_hoeffding_tree::get_num_leaves() const {
+    return num_leaves;
+}
+
+int compact_hoeffding_tree::get_num_active_leaves() const {
+    return num_active_leaves;
+}
+
+long compact_hoeffding_tree::get_live_bytes() const {
+    long bytes = sizeof(compact_hoeffding_tree) + num_nodes * get_node_bytes() + live_stats_bytes;
+    if (shared_log != nullptr) {
+        long num_rows = shared_log->get_end_row() - shared_first_row;
+        bytes += shared_weights.size()
+                 + num_rows * shared_log->get_row_bytes() / std::max(shared_log->get_num_attached(), 1);
+    }
+    return bytes;
+}
+
+long compact_hoeffding_tree::get_memory_bytes() const {
+    return sizeof(compact_hoeffding_tree)
+           + arena.get_reserved_bytes()
+           + values.capacity() * sizeof(double)
+           + batch_values.capacity() * sizeof(double)
+           + batch_labels.capacity() * sizeof(int)
+           + batch_weights.capacity() * sizeof(double)
+           + routed_rows.capacity() * sizeof(std::pair<node*, int>)
+           + free_stats.capacity() * sizeof(leaf_stats*)
+           + shared_weights.capacity();
+}
+
+compact_hoeffding_tree::node* compact_hoeffding_tree::copy_subtree(const node* src) {
+    node* cur = new_node();
+    cur->split_att = src->split_att;
+    cur->split_value = src->split_value;
+    memcpy(cur->class_weights, src->class_weights, num_classes * sizeof(double));
+
+    if (src->stats != nullptr) {
+        int num_tracked = src->stats->num_tracked;
+        cur->stats = acquire_stats(num_tracked);
+        cur->stats->weight_at_last_eval = src->stats->weight_at_last_eval;
+        cur->stats->eval_delay = src->stats->eval_delay;
+        cur->stats->mc_correct_weight = src->stats->mc_correct_weight;
+        cur->stats->nb_correct_weight = src->stats->nb_correct_weight;
+        memcpy(cur->stats->tracked_atts, src->stats->tracked_atts, num_tracked * sizeof(int));
+        memcpy(cur->stats->observers,
+               src->stats->observers,
+               num_classes * get_observer_width() * num_tracked * sizeof(double));
+    }
+
+    if (src->split_att >= 0) {
+        cur->left = copy_subtree(src->left);
+        cur->right = copy_subtree(src->right);
+    }
+    return cur;
+}
+
+void compact_hoeffding_tree::write_to(string& buffer) const {
+    if (shared_log != nullptr && root != nullptr) {
+        // written as the private tree it would be
+        compact_hoeffding_tree(*this).write_to(buffer);
+        return;
+    }
+
+    write_value<int>(buffer, grace_period);
+    write_value<double>(buffer, split_confidence);
+    write_value<double>(buffer, tie_threshold);
+    write_value<int>(buffer, num_split_points);
+    write_value<double>(buffer, min_branch_fraction);
+    write_value<int>(buffer, num_bins);
+    write_value<bool>(buffer, adaptive_grace_period);
+    write_value<long>(buffer, num_split_attempts);
+    write_value<long>(buffer, num_split_attempts_saved);
+    write_value<long>(buffer, memory_budget);
+    write_value<long>(buffer, instances_since_check);
+    write_value<bool>(buffer, remove_poor_attributes);
+    write_value<bool>(buffer, root != nullptr);
+    if (root == nullptr) {
+        return;
+    }
+
+    write_value<int>(buffer, num_attributes);
+    write_value<int>(buffer, num_classes);
+    write_value<int>(buffer, num_nodes);
+    write_value<int>(buffer, num_leaves);
+    write_value<int>(buffer, num_active_leaves);
+    write_subtree(root, buffer);
+}
+
+// preorder
+void compact_hoeffding_tree::write_subtree(const node* cur, string& buffer) const {
+    write_value<int>(buffer, cur->split_att);
+    write_value<double>(buffer, cur->split_value);
+    write_array(buffer, cur->class_weights, num_classes);
+    write_value<bool>(buffer, cur->stats != nullptr);
+    if (cur->stats != nullptr) {
+        int num_tracked = cur->stats->num_tracked;
+        write_value<double>(buffer, cur->stats->weight_at_last_eval);
+        write_value<double>(buffer, cur->stats->eval_delay);
+        write_value<double>(buffer, cur->stats->mc_correct_weight);
+        write_value<double>(buffer, cur->stats->nb_correct_weight);
+        write_value<int>(buffer, num_tracked);
+        write_array(buffer, cur->stats->tracked_atts, num_tracked);
+        write_array(buffer, cur->stats->observers, num_classes * get_observer_width() * num_tracked);
+    }
+
+    if (cur->split_att >= 0) {
+        write_subtree(cur->left, buffer);
+        write_subtree(cur->right, buffer);
+    }
+}
+
+unique_ptr<compact_hoeffding_tree> compact_hoeffding_tree::read_from(const string& buffer, size_t& pos) {
+    unique_ptr<compact_hoeffding_tree> tree = make_unique<compact_hoeffding_tree>();
+    tree->grace_period = read_value<int>(buffer, pos);
+    tree->split_confidence = read_value<double>(buffer, pos);
+    tree->tie_threshold = read_value<double>(buffer, pos);
+    tree->num_split_points = read_value<int>(buffer, pos);
+    tree->min_branch_fraction = read_value<double>(buffer, pos);
+    tree->num_bins = read_value<int>(buffer, pos);
+    tree->adaptive_grace_period = read_value<bool>(buffer, pos);
+    tree->num_split_attempts = read_value<long>(buffer, pos);
+    tree->num_split_attempts_saved = read_value<long>(buffer, pos);
+    tree->memory_budget = read_value<long>(buffer, pos);
+    tree->instances_since_check = read_value<long>(buffer, pos);
+    tree->remove_poor_attributes = read_value<bool>(buffer, pos);
+    if (!read_value<bool>(buffer, pos)) {
+        return tree;
+    }
+
+    tree->num_attributes = read_value<int>(buffer, pos);
+    tree->num_classes = read_value<int>(buffer, pos);
+    tree->num_nodes = read_value<int>(buffer, pos);
+    tree->num_leaves = read_value<int>(buffer, pos);
+    tree->num_active_leaves = read_value<int>(buffer, pos);
+    tree->values.resize(tree->num_attributes);
+    tree->free_stats.resize(tree->num_attributes + 1, nullptr);
+    tree->root = tree->read_subtree(buffer, pos);
+    return tree;
+}
+
+compact_hoeffding_tree::node* compact_hoeffding_tree::read_subtree(const string& buffer, size_t& pos) {
+    node* cur = new_node();
+    cur->split_att = read_value<int>(buffer, pos);
+    cur->split_value = read_value<double>(buffer, pos);
+    read_array(buffer, pos, cur->class_weights, num_classes);
+    if (read_value<bool>(buffer, pos)) {
+        double weight_at_last_eval = read_value<double>(buffer, pos);
+        double eval_delay = read_value<double>(buffer, pos);
+        double mc_correct_weight = read_value<double>(buffer, pos);
+        double nb_correct_weight = read_value<double>(buffer, pos);
+        int num_tracked = read_value<int>(buffer, pos);
+        if (num_tracked < 0 || num_tracked > num_attributes) {
+            cout << "compact_hoeffding_tree: invalid leaf width " << num_tracked << endl;
+            exit(1);
+        }
+
+        cur->stats = acquire_stats(num_tracked);
+        cur->stats->weight_at_last_eval = weight_at_last_eval;
+        cur->stats->eval_delay = eval_delay;
+        cur->stats->mc_correct_weight = mc_correct_weight;
+        cur->stats->nb_correct_weight = nb_correct_weight;
+        read_array(buffer, pos, cur->stats->tracked_atts, num_tracked);
+        read_array(buffer, pos, cur->stats->observers, num_classes * get_observer_width() * num_tracked);
+    }
+
+    if (cur->split_att >= 0) {
+        cur->left = read_subtree(buffer, pos);
+        cur->right = read_subtree(buffer, pos);
+    }
+    return cur;
+}
@@ -0,0 +1,308 @@
+#ifndef COMPACT_HOEFFDING_TREE_H
+#define COMPACT_HOEFFDING_TREE_H
+
+#include <streamDM/streams/ArffReader.h>
+
+#include "node_arena.h"
+#include "shared_observation_log.h"
+#include "observer_kernels.h"
+#include "split_scheduler.h"
+#include "attribute_workers.h"
+#include "tree_serialization.h"
+
+// Hoeffding tree whose nodes and leaf statistics live in a node_arena.
+// Follows streamDM's defaults: Gaussian numeric observers per class and
+// attribute, info gain over evenly spaced split points, Hoeffding bound with
+// tie breaking, and adaptive naive Bayes leaves. Attribute values are all
+// split on as numbers, so nominal attributes get binary threshold splits.
+// With bins set, attribute values are bin indices (see quantile_discretizer)
+// and observed through per-class histograms whose split points are the bin
+// boundaries, naive Bayes uses their Laplace-smoothed frequencies.
+// Statistics of a leaf are laid out per class as contiguous arrays over the
+// attributes it observes; the blocks of split or deactivated leaves are
+// recycled for new leaves of the same width.
+// Destroying the tree frees the arena's chunks, not its nodes one by one.
+class compact_hoeffding_tree {
+public:
+    compact_hoeffding_tree();
+    // deep copy, the nodes are laid out depth-first in a fresh arena. A shared
+    // root is copied as a private leaf.
+    compact_hoeffding_tree(const compact_hoeffding_tree& rhs);
+    compact_hoeffding_tree& operator=(const compact_hoeffding_tree&) = delete;
+    ~compact_hoeffding_tree();
+
+    // untrained tree with the same settings
+    unique_ptr<compact_hoeffding_tree> clone_settings() const;
+
+    void train(const Instance& instance, double weight);
+    // trains the same tree as calling train on each instance in turn. The
+    // batch is routed from the root once and trained leaf by leaf, each
+    // leaf's instances in batch order; leaves do not depend on each other, so
+    // split attempts fall on the same instances. The batch is cut where a
+    // memory budget check falls due, and a shared root is trained instance
+    // by instance until it leaves the log.
+    void train_batch(const vector<const Instance*>& instances, const vector<double>& weights);
+    // argmax of the class votes, safe to call concurrently on a tree not being trained
+    int predict(Instance& instance) const;
+
+    // An untrained tree's root observes the instances appended to the log
+    // from now on and stores only its weight of each row; it must be trained
+    // on the newest row of the log. The root rebuilds its observers from the
+    // log at each split attempt and predicts the majority class meanwhile.
+    // It becomes private when it splits, once naive Bayes would have been
+    // right more often than the majority class, when it is trained on anything else
+    // or on a fractional or large weight, or once its weights plus its share
+    // of the log cost more than private observers.
+    void share_root(shared_ptr<shared_observation_log> log);
+    bool is_root_shared() const;
+    // rebuilds the root's observers and leaves the log
+    void unshare_root();
+
+    // bytes of nodes and leaf statistics the tree may keep alive (0: unlimited).
+    // Checked every memory_check_period instances: leaves are ranked by the
+    // weight they misclassify and the least promising ones are deactivated,
+    // dropping their observers, until the rest fits. Once that has happened,
+    // attributes trailing a leaf's best split by more than the Hoeffding
+    // bound are no longer observed at that leaf.
+    // Only live bytes (get_live_bytes) are bounded: dropped statistics stay
+    // in the arena for leaves tracking as many attributes, so the reserved
+    // bytes (get_memory_bytes) may exceed the budget.
+    void set_memory_budget(long budget_bytes);
+    long get_memory_budget() const;
+
+    // histogram observers over bins 0 .. num_bins-1 (0: Gaussian observers),
+    // set before the tree is trained
+    void set_num_bins(int num_bins);
+    int get_num_bins() const;
+
+    // after a failed split attempt, a leaf waits until the Hoeffding bound
+    // could fall below its current merit gap (or the tie threshold) instead
+    // of one grace period. Saved attempts count the grace period boundaries
+    // skipped that way.
+    void set_adaptive_grace_period(bool enabled);
+    long get_num_split_attempts() const;
+    long get_num_split_attempts_saved() const;
+
+    // split attempts of private leaves are evaluated on the scheduler's
+    // workers while the tree waits for its next instance, which applies the
+    // outcome before it is routed. Trees sharing a scheduler evaluate in parallel.
+    void set_split_scheduler(shared_ptr<split_scheduler> scheduler);
+
+    // leaves observing at least min_attributes attributes update their
+    // observers and evaluate split candidates column-partitioned across the
+    // workers, each partition's best candidates are merged in column order,
+    // so trees are the same as without workers. A call finding the workers
+    // busy with another tree runs serially.
+    void set_attribute_workers(shared_ptr<attribute_workers> workers, int min_attributes);
+
+    int get_num_nodes() const;
+    int get_num_leaves() const;
+    int get_num_active_leaves() const;
+    // nodes and statistics in use, as counted against the budget
+    long get_live_bytes() const;
+    // includes arena space held for recycling
+    long get_memory_bytes() const;
+
+    // waits for a split evaluated on the scheduler and applies it,
+    // write_to leaves a pending split out
+    void apply_pending_split();
+    void write_to(string& buffer) const;
+    static unique_ptr<compact_hoeffding_tree> read_from(const string& buffer, size_t& pos);
+
+private:
+    struct leaf_stats {
+        double weight_at_last_eval;
+        // weight to wait for after weight_at_last_eval, grace_period if smaller
+        double eval_delay;
+        double mc_correct_weight;
+        double nb_correct_weight;
+        int num_tracked;
+        // the attribute observed in each column
+        int* tracked_atts;
+        // per class: weight, mean, m2, min and max, each num_tracked long, or
+        // with bins one histogram per tracked attribute, its total last
+        double* observers;
+        leaf_stats* next_free;
+    };
+
+    struct node {
+        int split_att; // -1 for leaves
+        double split_value;
+        node* left; // split_value and below
+        node* right;
+        double* class_weights;
+        leaf_stats* stats; // null at inner nodes and deactivated leaves
+    };
+
+    // outcome of a split attempt, found without modifying the leaf
+    struct split_decision {
+        bool attempted = false; // fewer than two observed classes are not attempted
+        bool split = false;
+        int att = -1;
+        double value = 0;
+        vector<double> branch_weights;
+        // columns within the Hoeffding bound of the best split
+        vector<int> kept_columns;
+        double weight_seen = 0;
+        // weight at which the bound falls below the current merit gap
+        double split_weight = 0;
+    };
+
+    // best and second best merit of a range of columns
+    struct split_candidate {
+        int column = -1;
+        double merit = -numeric_limits<double>::infinity();
+        double second_merit = -numeric_limits<double>::infinity();
+        double value = 0;
+        vector<double> branch_weights;
+    };
+
+    struct pending_split {
+        shared_ptr<split_task> task;
+        node* leaf;
+        split_decision decision;
+    };
+
+    static const int num_observer_stats = 5;
+    static const int memory_check_period = 1000;
+    // a shared root recounts its naive Bayes weight at most once per
+    // 1/shared_recount_ratio of its rows, beyond that it takes private stats
+    static const int shared_recount_ratio = 4;
+
+    int grace_period = 200;
+    double split_confidence = 1e-7;
+    double tie_threshold = 0.05;
+    int num_split_points = 10;
+    double min_branch_fraction = 0.01;
+    int num_bins = 0;
+    bool adaptive_grace_period = false;
+    long num_split_attempts = 0;
+    long num_split_attempts_saved = 0;
+
+    long memory_budget = 0;
+    long instances_since_check = 0;
+    bool remove_poor_attributes = false;
+
+    shared_ptr<shared_observation_log> shared_log;
+    long shared_first_row = 0;
+    // the root's weight of each row from shared_first_row on
+    vector<uint8_t> shared_weights;
+    double shared_weight_at_last_eval = 0;
+    double shared_eval_delay = 0;
+    // the root's counters as a private root would keep them: majority class
+    // exactly, naive Bayes exactly up to shared_counted_rows, plus the weight
+    // of the rows since
+    double shared_mc_correct_weight = 0;
+    double shared_nb_correct_weight = 0;
+    double shared_unchecked_weight = 0;
+    long shared_counted_rows = 0;
+
+    shared_ptr<split_scheduler> scheduler;
+    unique_ptr<pending_split> pending;
+
+    shared_ptr<attribute_workers> vertical_workers;
+    int min_parallel_attributes = 0;
+
+    int num_attributes = -1;
+    int num_classes = -1;
+    int num_nodes = 0;
+    int num_leaves = 0;
+    int num_active_leaves = 0;
+    long live_stats_bytes = 0;
+    node* root = nullptr;
+    node_arena arena;
+    // indexed by num_tracked
+    vector<leaf_stats*> free_stats;
+
+    // training scratch
+    vector<double> values;
+    // train_batch scratch: attribute values, labels and weights per row, and
+    // the leaf each row reaches at the start of the batch
+    vector<double> batch_values;
+    vector<int> batch_labels;
+    vector<double> batch_weights;
+    vector<std::pair<node*, int>> routed_rows;
+
+    void init_schema(int num_attributes, int num_classes);
+    node* new_node();
+    long get_node_bytes() const;
+    long get_stats_bytes(int num_tracked) const;
+    int get_observer_width() const;
+    leaf_stats* acquire_stats(int num_tracked);
+    // observes every attribute
+    leaf_stats* acquire_full_stats();
+    void release_stats(leaf_stats* stats);
+    // observers and correct weights of a root trained on the log's rows with
+    // the given weights
+    leaf_stats* replay_shared_rows(const shared_observation_log& log,
+                                   long first_row,
+                                   const vector<uint8_t>& weights);
+    bool can_share(const Instance& instance, double weight) const;
+    void train_shared_root(int label, double weight);
+    void leave_shared_log();
+    double* observer_block(const leaf_stats* stats, int label) const;
+
+    node* find_leaf(node* cur, const double* values) const;
+    // returns true when a split attempt is due at the leaf
+    bool train_leaf(node* leaf, int label, const double* values, double weight);
+    // trains on instances from begin on up to the next memory budget check,
+    // returns the index after the last one consumed
+    size_t train_grouped(const vector<const Instance*>& instances, const vector<double>& weights, size_t begin);
+    bool is_attribute_parallel(int num_tracked) const;
+    void update_observers(leaf_stats* stats, int label, const double* values, double weight);
+    void update_observer_columns(const leaf_stats* stats,
+                                 double* block,
+                                 const double* values,
+                                 double weight,
+                                 int begin,
+                                 int end);
+    void update_histograms(int num_tracked,
+                           const int* tracked_atts,
+                           double* block,
+                           const double* values,
+                           double weight) const;
+    int get_bin(double value) const;
+    int predict_majority(const node* leaf) const;
+    int predict_naive_bayes(const node* leaf, const double* values) const;
+    double gaussian_log_likelihood(int num_tracked,
+                                   const int* tracked_atts,
+                                   const double* block,
+                                   const double* values) const;
+    double histogram_log_likelihood(int num_tracked,
+                                    const int* tracked_atts,
+                                    const double* block,
+                                    const double* values) const;
+
+    void attempt_split(node* leaf);
+    // reads only the leaf and the settings, so it may run on a worker
+    void evaluate_split(const node* leaf, split_decision& decision) const;
+    void apply_split_decision(node* leaf, const split_decision& decision);
+    void schedule_split(node* leaf);
+    // waits for the pending evaluation and applies it
+    void finish_pending_split();
+    bool is_split_due(double weight_since_eval, double eval_delay) const;
+    void evaluate_columns(const node* leaf,
+                          int begin,
+                          int end,
+                          vector<double>& merits,
+                          split_candidate& candidate) const;
+    // merit of the best split point of one observer column, best_weights
+    // receives the left then right class weights of that split
+    double evaluate_column(const node* leaf, int column, double& best_value, vector<double>& best_weights) const;
+    double evaluate_histogram(const node* leaf, int column, double& best_value, vector<double>& best_weights) const;
+    double info_gain(const double* pre_weights, const double* branch_weights) const;
+    void apply_split(node* leaf, int att_idx, double split_value, const vector<double>& branch_weights);
+    // keeps the listed observer columns of a leaf
+    void drop_columns(node* leaf, const vector<int>& kept_columns);
+
+    void enforce_memory_budget();
+    void collect_leaves(node* cur, vector<node*>& leaves) const;
+    void activate(node* leaf);
+    void deactivate(node* leaf);
+
+    node* copy_subtree(const node* src);
+    void write_subtree(const node* cur, string& buffer) const;
+    node* read_subtree(const string& buffer, size_t& pos);
+};
+
+#endif //COMPACT_HOEFFDING_TREE_H
@@ -0,0 +1,212 @@
+#include <cfloat>
+#include <cmath>
+
+#include "coreset_summary.h"
+
+coreset_summary::coreset_summary(int max_size) : max_size(max_size) {
+    if (max_size < 1) {
+        cout << "coreset_summary: max_size must be positive" << endl;
+        exit(1);
+    }
+}
+
+void coreset_summary::add(Instance& instance) {
+    if (num_attributes == -1) {
+        num_attributes = instance.getNumberInputAttributes();
+        instance_information = instance.getInstanceInformation();
+        min_values.assign(num_attributes, DBL_MAX);
+        max_values.assign(num_attributes, -DBL_MAX);
+    }
+
+    vector<double> row(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        row[i] = instance.getInputAttributeValue(i);
+        min_values[i] = std::min(min_values[i], row[i]);
+        max_values[i] = std::max(max_values[i], row[i]);
+    }
+    int label = instance.getLabel();
+    absorbed_count++;
+
+    int nearest = -1;
+    double nearest_distance = DBL_MAX;
+    for (int i = 0; i < labels.size(); i++) {
+        if (labels[i] != label) {
+            continue;
+        }
+        double cur_distance = distance(&values[i * num_attributes], row.data());
+        if (cur_distance < nearest_distance) {
+            nearest_distance = cur_distance;
+            nearest = i;
+        }
+    }
+
+    if (nearest != -1 && nearest_distance <= radius) {
+        merge_into(nearest, row.data(), 1);
+        return;
+    }
+
+    values.insert(values.end(), row.begin(), row.end());
+    labels.push_back(label);
+    weights.push_back(1);
+
+    if (labels.size() > max_size) {
+        reduce();
+    }
+}
+
+// doubles the radius until merging brings the representatives under max_size
+void coreset_summary::reduce() {
+    if (radius == 0) {
+        // start from the closest pair that could be merged
+        double closest = DBL_MAX;
+        for (int i = 0; i < labels.size(); i++) {
+            for (int j = i + 1; j < labels.size(); j++) {
+                if (labels[i] == labels[j]) {
+                    closest = std::min(closest,
+                                       distance(&values[i * num_attributes], &values[j * num_attributes]));
+                }
+            }
+        }
+        if (closest == DBL_MAX) {
+            // one representative per class, nothing can be merged
+            return;
+        }
+        radius = closest / 2;
+    }
+
+    // scaled attributes lie in [0, 1], beyond this radius every class has
+    // collapsed into a single representative
+    double max_radius = 2 * sqrt((double) num_attributes) + 1;
+
+    while (labels.size() > max_size && radius <= max_radius) {
+        radius *= 2;
+
+        for (int i = 0; i < labels.size(); i++) {
+            int j = i + 1;
+            while (j < labels.size()) {
+                if (labels[j] == labels[i]
+                    && distance(&values[i * num_attributes], &values[j * num_attributes]) <= radius) {
+                    vector<double> row(values.begin() + j * num_attributes,
+                                       values.begin() + (j + 1) * num_attributes);
+                    merge_into(i, row.data(), weights[j]);
+                    remove(j);
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+}
+
+double coreset_summary::distance(const double* lhs, const double* rhs) const {
+    double sum = 0;
+    for (int i = 0; i < num_attributes; i++) {
+        double range = max_values[i] - min_values[i];
+        if (range <= 0) {
+            continue;
+        }
+        double diff = (lhs[i] - rhs[i]) / range;
+        sum += diff * diff;
+    }
+    return sqrt(sum);
+}
+
+void coreset_summary::merge_into(int target, const double* row, double weight) {
+    double* target_row = &values[target * num_attributes];
+    double total_weight = weights[target] + weight;
+    for (int i = 0; i < num_attributes; i++) {
+        target_row[i] += (row[i] - target_row[i]) * weight / total_weight;
+    }
+    weights[target] = total_weight;
+}
+
+// order is not preserved
+void coreset_summary::remove(int idx) {
+    int last = labels.size() - 1;
+    if (idx != last) {
+        std::copy(values.begin() + last * num_attributes,
+                  values.begin() + (last + 1) * num_attributes,
+                  values.begin() + idx * num_attributes);
+        labels[idx] = labels[last];
+        weights[idx] = weights[last];
+    }
+    values.resize(last * num_attributes);
+    labels.pop_back();
+    weights.pop_back();
+}
+
+int coreset_summary::size() const {
+    return labels.size();
+}
+
+int coreset_summary::get_max_size() const {
+    return max_size;
+}
+
+long coreset_summary::get_absorbed_count() const {
+    return absorbed_count;
+}
+
+double coreset_summary::get_radius() const {
+    return radius;
+}
+
+void coreset_summary::materialize(int idx, DenseInstance& view) const {
+    view.mInputData.assign(values.begin() + idx * num_attributes,
+                           values.begin() + (idx + 1) * num_attributes);
+    view.mOutputData.assign(1, (double) labels[idx]);
+    view.setInstanceInformation(instance_information);
+    view.setWeight(weights[idx]);
+}
+
+long coreset_summary::get_memory_bytes() const {
+    return sizeof(coreset_summary)
+           + values.capacity() * sizeof(double)
+           + labels.capacity() * sizeof(int)
+           + weights.capacity() * sizeof(double)
+           + (min_values.capacity() + max_values.capacity()) * sizeof(double);
+}
+
+void coreset_summary::write_to(string& buffer) const {
+    write_value<int>(buffer, max_size);
+    write_value<int>(buffer, num_attributes);
+    write_value<double>(buffer, radius);
+    write_value<long>(buffer, absorbed_count);
+    write_value<int>(buffer, labels.size());
+
+    for (int i = 0; i < num_attributes; i++) {
+        write_value<double>(buffer, min_values[i]);
+        write_value<double>(buffer, max_values[i]);
+    }
+    for (int i = 0; i < labels.size(); i++) {
+        write_value<int>(buffer, labels[i]);
+        write_value<double>(buffer, weights[i]);
+        for (int j = 0; j < num_attributes; j++) {
+            write_value<double>(buffer, values[i * num_attributes + j]);
+        }
+    }
+}
+
+unique_ptr<coreset_summary> coreset_summary::read_from(const string& buffer,
+                                                       size_t& pos,
+                                                       InstanceInformation* instance_information) {
+    unique_ptr<coreset_summary> summary = make_unique<coreset_summary>(read_value<int>(buffer, pos));
+    summary->num_attributes = read_value<int>(buffer, pos);
+    summary->radius = read_value<double>(buffer, pos);
+    summary->absorbed_count = read_value<long>(buffer, pos);
+    summary->instance_information = instance_information;
+    int num_representatives = read_value<int>(buffer, pos);
+
+    for (int i = 0; i < summary->num_attributes; i++) {
+        summary->min_values.push_back(read_value<double>(buffer, pos));
+        summary->max_values.push_back(read_value<double>(buffer, pos));
+    }
+    for (int i = 0; i < num_representatives; i++) {
+        summary->labels.push_back(read_value<int>(buffer, pos));
+        summary->weights.push_back(read_value<double>(buffer, pos));
+        for (int j = 0; j < summary->num_attributes; j++) {
+            summary->values.push_back(read_value<double>(buffer, pos));
+        }
+    }
+    return summary;
+}
@@ -0,0 +1,61 @@
+#ifndef CORESET_SUMMARY_H
+#define CORESET_SUMMARY_H
+
+#include <streamDM/streams/ArffReader.h>
+
+#include "tree_serialization.h"
+
+// Bounded weighted summary of the instances a tree keeps for replay.
+// Instances are absorbed incrementally with the doubling algorithm: an
+// instance within `radius` of a representative of the same class is merged
+// into it (weighted mean, weights add up), otherwise it becomes a new
+// representative. When more than max_size representatives exist, the radius
+// is doubled and representatives within the new radius are merged until the
+// bound holds again. Distances are measured on attributes scaled by their
+// observed range.
+// Replaying the representatives with their weights approximates replaying
+// every absorbed instance; a smaller max_size is cheaper to replay and
+// coarser (larger radius).
+class coreset_summary {
+public:
+    explicit coreset_summary(int max_size);
+
+    void add(Instance& instance);
+
+    int size() const;
+    int get_max_size() const;
+    long get_absorbed_count() const;
+    double get_radius() const;
+
+    // the representative's weight is set as the view's instance weight
+    void materialize(int idx, DenseInstance& view) const;
+    long get_memory_bytes() const;
+
+    void write_to(string& buffer) const;
+    static unique_ptr<coreset_summary> read_from(const string& buffer,
+                                                 size_t& pos,
+                                                 InstanceInformation* instance_information);
+
+private:
+    int max_size;
+    int num_attributes = -1;
+    double radius = 0;
+    long absorbed_count = 0;
+    InstanceInformation* instance_information = nullptr;
+
+    // representatives, values row-major
+    vector<double> values;
+    vector<int> labels;
+    vector<double> weights;
+
+    // observed attribute ranges
+    vector<double> min_values;
+    vector<double> max_values;
+
+    double distance(const double* lhs, const double* rhs) const;
+    void merge_into(int target, const double* row, double weight);
+    void remove(int idx);
+    void reduce();
+};
+
+#endif //CORESET_SUMMARY_H
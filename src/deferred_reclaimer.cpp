@@ -0,0 +1,65 @@
+#include "deferred_reclaimer.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+deferred_reclaimer::deferred_reclaimer() : retired_count(0) {
+    worker = std::thread(&deferred_reclaimer::run, this);
+    // never joined, the reclaimer lives as long as the process
+    worker.detach();
+}
+
+deferred_reclaimer& deferred_reclaimer::get_process_reclaimer() {
+    static deferred_reclaimer* reclaimer = new deferred_reclaimer();
+    return *reclaimer;
+}
+
+void deferred_reclaimer::retire(shared_ptr<void> object) {
+    if (object == nullptr) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        pending.push_back(std::move(object));
+    }
+    retired_count++;
+    work_available.notify_one();
+}
+
+void deferred_reclaimer::drain() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    queue_drained.wait(lock, [this] { return pending.empty() && !reclaiming; });
+}
+
+long deferred_reclaimer::get_retired_count() const {
+    return retired_count;
+}
+
+long deferred_reclaimer::get_pending_count() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return pending.size();
+}
+
+void deferred_reclaimer::run() {
+    // lowest priority for this thread only, on Linux nice values are per thread
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+
+    vector<shared_ptr<void>> batch;
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+        work_available.wait(lock, [this] { return !pending.empty(); });
+        batch.swap(pending);
+        reclaiming = true;
+
+        lock.unlock();
+        batch.clear();
+        lock.lock();
+
+        reclaiming = false;
+        if (pending.empty()) {
+            queue_drained.notify_all();
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef DEFERRED_RECLAIMER_H
+#define DEFERRED_RECLAIMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Process-wide queue of discarded learner state.
+// Trees and pools thrown away during training are retired here instead of
+// being destroyed in place; a low-priority thread drops the references in
+// batches, so destructor storms stay off the training threads. Retiring a
+// reference that is still shared elsewhere only delays the decrement.
+class deferred_reclaimer {
+public:
+    static deferred_reclaimer& get_process_reclaimer();
+
+    void retire(shared_ptr<void> object);
+    // blocks until everything retired so far has been released
+    void drain();
+
+    long get_retired_count() const;
+    long get_pending_count() const;
+
+private:
+    deferred_reclaimer();
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable work_available;
+    std::condition_variable queue_drained;
+    vector<shared_ptr<void>> pending;
+    bool reclaiming = false;
+    std::atomic<long> retired_count;
+    std::thread worker;
+
+    void run();
+};
+
+#endif //DEFERRED_RECLAIMER_H
@@ -0,0 +1,371 @@
+#include "drift_detector_bank.h"
+
+drift_detector_enum parse_drift_detector(const string& detector_str) {
+    static const std::map<string, drift_detector_enum> detector_map =
+            {
+                    { "adwin", drift_detector_enum::adwin_detector },
+                    { "ddm", drift_detector_enum::ddm_detector },
+                    { "eddm", drift_detector_enum::eddm_detector },
+                    { "hddm_a", drift_detector_enum::hddm_a_detector },
+            };
+
+    auto it = detector_map.find(detector_str);
+    if (it == detector_map.end()) {
+        cout << "Invalid drift detector: " << detector_str << endl;
+        exit(1);
+    }
+    return it->second;
+}
+
+drift_detector_bank::drift_detector_bank(drift_detector_enum detector, int num_members, double delta) :
+        detector(detector),
+        num_members(num_members),
+        delta(delta) {
+
+    switch (detector) {
+        case drift_detector_enum::adwin_detector:
+            width.resize(num_members);
+            total.resize(num_members);
+            variance.resize(num_members);
+            time.resize(num_members);
+            num_levels.resize(num_members);
+            bucket_counts.resize(adwin_max_levels * num_members);
+            bucket_totals.resize(adwin_max_levels * (adwin_max_buckets + 1) * num_members);
+            bucket_variances.resize(bucket_totals.size());
+            break;
+        case drift_detector_enum::ddm_detector:
+            num_instances.resize(num_members);
+            error_rate.resize(num_members);
+            min_rate.resize(num_members);
+            min_std.resize(num_members);
+            break;
+        case drift_detector_enum::eddm_detector:
+            num_instances.resize(num_members);
+            num_errors.resize(num_members);
+            last_error.resize(num_members);
+            mean_distance.resize(num_members);
+            distance_m2.resize(num_members);
+            max_score.resize(num_members);
+            break;
+        case drift_detector_enum::hddm_a_detector:
+            num_instances.resize(num_members);
+            num_errors.resize(num_members);
+            cut_instances.resize(num_members);
+            cut_errors.resize(num_members);
+            break;
+    }
+
+    for (int i = 0; i < num_members; i++) {
+        reset(i);
+    }
+}
+
+drift_detector_enum drift_detector_bank::get_detector() const {
+    return detector;
+}
+
+void drift_detector_bank::reset(int member) {
+    switch (detector) {
+        case drift_detector_enum::adwin_detector:
+            width[member] = 0;
+            total[member] = 0;
+            variance[member] = 0;
+            time[member] = 0;
+            num_levels[member] = 0;
+            for (int level = 0; level < adwin_max_levels; level++) {
+                bucket_counts[level * num_members + member] = 0;
+            }
+            break;
+        case drift_detector_enum::ddm_detector:
+            num_instances[member] = 0;
+            error_rate[member] = 0;
+            min_rate[member] = numeric_limits<double>::max();
+            min_std[member] = numeric_limits<double>::max();
+            break;
+        case drift_detector_enum::eddm_detector:
+            num_instances[member] = 0;
+            num_errors[member] = 0;
+            last_error[member] = 0;
+            mean_distance[member] = 0;
+            distance_m2[member] = 0;
+            max_score[member] = 0;
+            break;
+        case drift_detector_enum::hddm_a_detector:
+            num_instances[member] = 0;
+            num_errors[member] = 0;
+            cut_instances[member] = 0;
+            cut_errors[member] = 0;
+            break;
+    }
+}
+
+// drifted members are reset before returning
+void drift_detector_bank::update(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted) {
+    if (num_active > num_members || errors.size() < num_active) {
+        cout << "drift_detector_bank: " << num_active << " active members, "
+             << num_members << " members, " << errors.size() << " errors" << endl;
+        exit(1);
+    }
+    drifted.assign(num_active, 0);
+
+    switch (detector) {
+        case drift_detector_enum::adwin_detector:
+            update_adwin(errors, num_active, drifted);
+            break;
+        case drift_detector_enum::ddm_detector:
+            update_ddm(errors, num_active, drifted);
+            break;
+        case drift_detector_enum::eddm_detector:
+            update_eddm(errors, num_active, drifted);
+            break;
+        case drift_detector_enum::hddm_a_detector:
+            update_hddm_a(errors, num_active, drifted);
+            break;
+    }
+
+    for (int i = 0; i < num_active; i++) {
+        if (drifted[i]) {
+            reset(i);
+        }
+    }
+}
+
+void drift_detector_bank::update_ddm(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted) {
+    for (int i = 0; i < num_active; i++) {
+        double n = num_instances[i] + 1;
+        double p = error_rate[i] + (errors[i] - error_rate[i]) / n;
+        double s = sqrt(p * (1 - p) / n);
+        num_instances[i] = n;
+        error_rate[i] = p;
+
+        bool warmed_up = n >= min_num_instances;
+        bool new_min = warmed_up && p + s <= min_rate[i] + min_std[i];
+        min_rate[i] = new_min ? p : min_rate[i];
+        min_std[i] = new_min ? s : min_std[i];
+        drifted[i] = warmed_up && p + s > min_rate[i] + 3 * min_std[i];
+    }
+}
+
+void drift_detector_bank::update_eddm(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted) {
+    for (int i = 0; i < num_active; i++) {
+        double n = num_instances[i] + 1;
+        num_instances[i] = n;
+        if (!errors[i]) {
+            continue;
+        }
+
+        double cur_num_errors = num_errors[i] + 1;
+        double distance = n - last_error[i];
+        double old_mean = mean_distance[i];
+        double mean = old_mean + (distance - old_mean) / cur_num_errors;
+        distance_m2[i] += (distance - mean) * (distance - old_mean);
+        num_errors[i] = cur_num_errors;
+        mean_distance[i] = mean;
+        last_error[i] = n;
+
+        double score = mean + 2 * sqrt(distance_m2[i] / cur_num_errors);
+        if (score > max_score[i]) {
+            if (n > min_num_instances) {
+                max_score[i] = score;
+            }
+        } else {
+            drifted[i] = n > min_num_instances
+                         && cur_num_errors > min_num_instances
+                         && score / max_score[i] < 0.9;
+        }
+    }
+}
+
+void drift_detector_bank::update_hddm_a(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted) {
+    double log_inv_delta = log(1.0 / delta);
+    double log_two_inv_delta = log(2.0 / delta);
+
+    for (int i = 0; i < num_active; i++) {
+        double n = num_instances[i] + 1;
+        double cur_num_errors = num_errors[i] + errors[i];
+        num_instances[i] = n;
+        num_errors[i] = cur_num_errors;
+
+        // the cut point is where the mean plus its bound was lowest
+        double bound = sqrt(log_inv_delta / (2 * n));
+        double cut_n = cut_instances[i];
+        if (cut_n == 0
+            || cur_num_errors / n + bound <= cut_errors[i] / cut_n + sqrt(log_inv_delta / (2 * cut_n))) {
+            cut_instances[i] = n;
+            cut_errors[i] = cur_num_errors;
+            continue;
+        }
+
+        double m = (n - cut_n) / (cut_n * n);
+        double drift_bound = sqrt(m / 2 * log_two_inv_delta);
+        drifted[i] = cur_num_errors / n - cut_errors[i] / cut_n >= drift_bound;
+    }
+}
+
+void drift_detector_bank::update_adwin(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted) {
+    // level 0 of every member receives its new bucket in one pass
+    for (int i = 0; i < num_active; i++) {
+        adwin_insert(i, errors[i]);
+    }
+
+    for (int i = 0; i < num_active; i++) {
+        adwin_compress(i);
+
+        time[i]++;
+        if (time[i] % adwin_clock != 0 || width[i] <= adwin_min_window) {
+            continue;
+        }
+
+        // estimation before the window was cut
+        double old_estimation = total[i] / width[i];
+        if (adwin_detect_cut(i)) {
+            // a falling error rate is not a drift
+            drifted[i] = width[i] == 0 || old_estimation <= total[i] / width[i];
+        }
+    }
+}
+
+size_t drift_detector_bank::bucket_idx(int level, int slot, int member) const {
+    return ((size_t) level * (adwin_max_buckets + 1) + slot) * num_members + member;
+}
+
+// slot 0 holds the oldest bucket of a level, level k buckets hold 2^k values
+void drift_detector_bank::adwin_insert(int member, double value) {
+    long cur_width = ++width[member];
+    if (cur_width > 1) {
+        double diff = value - total[member] / (cur_width - 1);
+        variance[member] += (cur_width - 1) * diff * diff / cur_width;
+    }
+    total[member] += value;
+
+    if (num_levels[member] == 0) {
+        num_levels[member] = 1;
+    }
+    int& count = bucket_counts[member];
+    bucket_totals[bucket_idx(0, count, member)] = value;
+    bucket_variances[bucket_idx(0, count, member)] = 0;
+    count++;
+}
+
+// a full level merges its two oldest buckets into one of the next level
+void drift_detector_bank::adwin_compress(int member) {
+    for (int level = 0; level < num_levels[member]; level++) {
+        int& count = bucket_counts[level * num_members + member];
+        if (count <= adwin_max_buckets) {
+            break;
+        }
+        if (level + 1 == adwin_max_levels) {
+            // the window is at its maximum length, the oldest values go
+            adwin_delete_oldest(member);
+            break;
+        }
+        if (level + 1 == num_levels[member]) {
+            num_levels[member]++;
+        }
+
+        double size = ldexp(1.0, level);
+        double total0 = bucket_totals[bucket_idx(level, 0, member)];
+        double total1 = bucket_totals[bucket_idx(level, 1, member)];
+        double mean_diff = total0 / size - total1 / size;
+        double merged_variance = bucket_variances[bucket_idx(level, 0, member)]
+                                 + bucket_variances[bucket_idx(level, 1, member)]
+                                 + size * size * mean_diff * mean_diff / (2 * size);
+
+        int& next_count = bucket_counts[(level + 1) * num_members + member];
+        bucket_totals[bucket_idx(level + 1, next_count, member)] = total0 + total1;
+        bucket_variances[bucket_idx(level + 1, next_count, member)] = merged_variance;
+        next_count++;
+
+        for (int slot = 2; slot < count; slot++) {
+            bucket_totals[bucket_idx(level, slot - 2, member)] = bucket_totals[bucket_idx(level, slot, member)];
+            bucket_variances[bucket_idx(level, slot - 2, member)] = bucket_variances[bucket_idx(level, slot, member)];
+        }
+        count -= 2;
+    }
+}
+
+void drift_detector_bank::adwin_delete_oldest(int member) {
+    int level = num_levels[member] - 1;
+    int& count = bucket_counts[level * num_members + member];
+    double size = ldexp(1.0, level);
+    double oldest_total = bucket_totals[bucket_idx(level, 0, member)];
+
+    width[member] -= (long) size;
+    total[member] -= oldest_total;
+    if (width[member] > 0) {
+        double diff = oldest_total / size - total[member] / width[member];
+        variance[member] -= bucket_variances[bucket_idx(level, 0, member)]
+                            + size * width[member] * diff * diff / (size + width[member]);
+    } else {
+        variance[member] = 0;
+    }
+
+    for (int slot = 1; slot < count; slot++) {
+        bucket_totals[bucket_idx(level, slot - 1, member)] = bucket_totals[bucket_idx(level, slot, member)];
+        bucket_variances[bucket_idx(level, slot - 1, member)] = bucket_variances[bucket_idx(level, slot, member)];
+    }
+    count--;
+    if (count == 0) {
+        num_levels[member]--;
+    }
+}
+
+// drops the oldest bucket while two sub-windows have significantly different means
+bool drift_detector_bank::adwin_detect_cut(int member) {
+    bool change = false;
+    bool reduce_width = true;
+    while (reduce_width) {
+        reduce_width = false;
+        bool done = false;
+        double n0 = 0;
+        double n1 = width[member];
+        double u0 = 0;
+        double u1 = total[member];
+
+        for (int level = num_levels[member] - 1; level >= 0 && !done; level--) {
+            int count = bucket_counts[level * num_members + member];
+            double size = ldexp(1.0, level);
+            for (int slot = 0; slot < count; slot++) {
+                double bucket_total = bucket_totals[bucket_idx(level, slot, member)];
+                n0 += size;
+                n1 -= size;
+                u0 += bucket_total;
+                u1 -= bucket_total;
+                if (level == 0 && slot == count - 1) {
+                    done = true;
+                    break;
+                }
+                if (n0 <= adwin_min_window + 1 || n1 <= adwin_min_window + 1) {
+                    continue;
+                }
+
+                double n = width[member];
+                double dd = log(2 * log(n) / delta);
+                double v = variance[member] / n;
+                double m = 1 / (n0 - adwin_min_window + 1) + 1 / (n1 - adwin_min_window + 1);
+                double epsilon = sqrt(2 * m * v * dd) + 2.0 / 3 * dd * m;
+                if (fabs(u0 / n0 - u1 / n1) > epsilon) {
+                    reduce_width = true;
+                    change = true;
+                    if (width[member] > 0) {
+                        adwin_delete_oldest(member);
+                        done = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return change;
+}
+
+long drift_detector_bank::get_memory_bytes() const {
+    return sizeof(drift_detector_bank)
+           + (width.capacity() * sizeof(long))
+           + (time.capacity() + num_levels.capacity() + bucket_counts.capacity()) * sizeof(int)
+           + (total.capacity() + variance.capacity() + bucket_totals.capacity() + bucket_variances.capacity()
+              + num_instances.capacity() + error_rate.capacity() + min_rate.capacity() + min_std.capacity()
+              + num_errors.capacity() + last_error.capacity() + mean_distance.capacity()
+              + distance_m2.capacity() + max_score.capacity()
+              + cut_instances.capacity() + cut_errors.capacity()) * sizeof(double);
+}
@@ -0,0 +1,83 @@
+#ifndef DRIFT_DETECTOR_BANK_H
+#define DRIFT_DETECTOR_BANK_H
+
+#include <cstdint>
+
+#include <streamDM/streams/ArffReader.h>
+
+enum class drift_detector_enum { adwin_detector, ddm_detector, eddm_detector, hddm_a_detector };
+drift_detector_enum parse_drift_detector(const string& detector_str);
+
+// Drift detectors of all members of a tree pool, updated together.
+// Every statistic is kept in its own array indexed by member, so one update
+// walks each array once for the whole pool. Only increases of the error
+// rate count as drift, and only drift is detected (no warning level).
+//   adwin:  ADWIN with the given delta. Bucket rows are stored level by
+//           level, slot by slot, across members; compression and cut checks
+//           depend on each member's history and run member by member.
+//   ddm:    error rate plus 3 standard deviations over its minimum
+//   eddm:   mean distance between errors plus 2 standard deviations below
+//           90% of its maximum
+//   hddm_a: Hoeffding bound test of the mean error against the mean at the
+//           point where it was lowest, with confidence delta
+class drift_detector_bank {
+public:
+    drift_detector_bank(drift_detector_enum detector, int num_members, double delta);
+
+    // errors[i] is 1 if member i mispredicted, the first num_active members
+    // are updated and drifted[i] is set to 1 where a drift was detected
+    void update(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted);
+    // the member starts over, e.g. when its tree was replaced
+    void reset(int member);
+
+    drift_detector_enum get_detector() const;
+    long get_memory_bytes() const;
+
+private:
+    static const int adwin_max_buckets = 5;
+    // windows of up to about 10M values
+    static const int adwin_max_levels = 20;
+    static const int adwin_clock = 32;
+    static const int adwin_min_window = 5;
+    static const int min_num_instances = 30;
+
+    drift_detector_enum detector;
+    int num_members;
+    double delta;
+
+    // adwin
+    vector<long> width;
+    vector<double> total;
+    vector<double> variance;
+    vector<int> time;
+    vector<int> num_levels;
+    vector<int> bucket_counts; // [level][member]
+    vector<double> bucket_totals; // [level][slot][member]
+    vector<double> bucket_variances;
+
+    // ddm, eddm and hddm_a
+    vector<double> num_instances;
+    vector<double> error_rate;
+    vector<double> min_rate;
+    vector<double> min_std;
+    vector<double> num_errors;
+    vector<double> last_error;
+    vector<double> mean_distance;
+    vector<double> distance_m2;
+    vector<double> max_score;
+    vector<double> cut_instances;
+    vector<double> cut_errors;
+
+    void update_adwin(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted);
+    void update_ddm(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted);
+    void update_eddm(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted);
+    void update_hddm_a(const vector<uint8_t>& errors, int num_active, vector<uint8_t>& drifted);
+
+    size_t bucket_idx(int level, int slot, int member) const;
+    void adwin_insert(int member, double value);
+    void adwin_compress(int member);
+    void adwin_delete_oldest(int member);
+    bool adwin_detect_cut(int member);
+};
+
+#endif //DRIFT_DETECTOR_BANK_H
@@ -6,7 +6,7 @@ import time
 
 import numpy as np
 from sklearn.metrics import cohen_kappa_score
-from trans_pearl_wrapper import adaptive_random_forest, pearl, trans_pearl_wrapper, trans_tree_wrapper
+from trans_pearl_wrapper import adaptive_random_forest, pearl, trans_pearl_wrapper, trans_tree_wrapper, learner_host
 
 import sys
 paths = [r'..', r'../third_party']
@@ -39,7 +39,8 @@ class Evaluator:
                     sample_freq,
                     metrics_loggers,
                     expected_drift_locs_list,
-                    acc_per_drift_logger):
+                    acc_per_drift_logger,
+                    predict_from_snapshot=False):
 
         classifier_metrics_list = []
         for i in range(len(data_file_paths)):
@@ -72,7 +73,10 @@ class Evaluator:
             classifier_metrics_list[classifier_idx].instance_idx += 1
 
             # test
-            prediction = classifier.predict()
+            if predict_from_snapshot:
+                prediction = classifier.predict_snapshot()
+            else:
+                prediction = classifier.predict()
 
             actual_label = classifier.get_cur_instance_label()
             if prediction == actual_label:
@@ -97,6 +101,44 @@ class Evaluator:
             # classifier.delete_cur_instance()
             self._log_metrics(classifier_metrics_list[classifier_idx].instance_idx, sample_freq, metric, classifier, metrics_loggers[classifier_idx])
 
+    def prequential_evaluation_host(
+                    self,
+                    host,
+                    tenant_ids,
+                    data_file_paths,
+                    sample_freq,
+                    metrics_loggers):
+
+        for i in range(len(data_file_paths)):
+            host.init_data_source(tenant_ids[i], data_file_paths[i])
+
+        start_time = time.process_time()
+        last_processed = [0] * len(tenant_ids)
+        last_correct = [0] * len(tenant_ids)
+        active_idx = list(range(len(tenant_ids)))
+        count = 0
+
+        # one instance per stream per round, streams arrive in parallel and
+        # run on the host's workers; a finished stream's tenant goes idle
+        while active_idx:
+            active_idx = [i for i in active_idx if host.submit_next(tenant_ids[i])]
+            count += 1
+
+            if count % sample_freq == 0 or not active_idx:
+                host.flush()
+                elapsed_time = time.process_time() - start_time
+                for i in range(len(tenant_ids)):
+                    processed, correct, pending, memory_estimate, hibernated = \
+                        host.get_tenant_stats(tenant_ids[i])
+                    if processed == last_processed[i]:
+                        continue
+                    accuracy = (correct - last_correct[i]) / (processed - last_processed[i])
+                    last_processed[i] = processed
+                    last_correct[i] = correct
+
+                    print(f"{tenant_ids[i]}: {processed},{accuracy},{memory_estimate},{hibernated},{elapsed_time}")
+                    metrics_loggers[i].info(f"{processed},{accuracy},{memory_estimate},{hibernated},{elapsed_time}")
+
     def _log_metrics(self, count, sample_freq, metric, classifier, metrics_logger):
         if count % sample_freq == 0 and count != 0:
             elapsed_time = time.process_time() - metric.start_time
@@ -0,0 +1,57 @@
+#include "instance_arena.h"
+
+instance_arena::instance_arena(int slab_size) :
+        slab_size(slab_size) {
+
+    if (slab_size < 1) {
+        cout << "instance_arena: slab size must be positive" << endl;
+        exit(1);
+    }
+    live_slab_count = make_shared<std::atomic<long>>(0);
+}
+
+instance_arena::slab::slab(int slab_size, shared_ptr<std::atomic<long>> live_slab_count) :
+        live_slab_count(live_slab_count) {
+    // never grows past the reservation, so instance addresses stay stable
+    instances.reserve(slab_size);
+    (*live_slab_count)++;
+}
+
+instance_arena::slab::~slab() {
+    (*live_slab_count)--;
+}
+
+shared_ptr<Instance> instance_arena::adopt(Instance* instance) {
+    if (instance == nullptr) {
+        return nullptr;
+    }
+
+    DenseInstance* dense_instance = dynamic_cast<DenseInstance*>(instance);
+    if (dense_instance == nullptr) {
+        cout << "instance_arena: only dense instances are supported" << endl;
+        exit(1);
+    }
+
+    if (current_slab == nullptr || current_slab->instances.size() >= slab_size) {
+        // the previous slab lives on through the instances that reference it
+        current_slab = make_shared<slab>(slab_size, live_slab_count);
+    }
+
+    current_slab->instances.push_back(std::move(*dense_instance));
+    delete instance;
+    adopted_count++;
+
+    return shared_ptr<Instance>(current_slab, &current_slab->instances.back());
+}
+
+long instance_arena::get_adopted_count() const {
+    return adopted_count;
+}
+
+long instance_arena::get_live_slab_count() const {
+    return live_slab_count->load();
+}
+
+int instance_arena::get_slab_size() const {
+    return slab_size;
+}
@@ -0,0 +1,44 @@
+#ifndef INSTANCE_ARENA_H
+#define INSTANCE_ARENA_H
+
+#include <atomic>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Per-stream slab storage for ingested instances.
+// Instances are moved out of the reader's heap allocation into fixed-size
+// slabs and handed out as shared_ptrs that alias their slab, so every
+// instance store, pool and warning window that keeps an instance keeps its
+// slab alive. A slab is released in one piece once nothing references any of
+// its instances, which makes memory proportional to retained state instead
+// of stream length.
+// adopt() must be called from a single thread, references may be dropped
+// from any thread.
+class instance_arena {
+public:
+    explicit instance_arena(int slab_size = 1024);
+
+    // takes ownership of a reader-allocated instance
+    shared_ptr<Instance> adopt(Instance* instance);
+
+    long get_adopted_count() const;
+    long get_live_slab_count() const;
+    int get_slab_size() const;
+
+private:
+    struct slab {
+        explicit slab(int slab_size, shared_ptr<std::atomic<long>> live_slab_count);
+        ~slab();
+
+        vector<DenseInstance> instances;
+        shared_ptr<std::atomic<long>> live_slab_count;
+    };
+
+    int slab_size;
+    long adopted_count = 0;
+    shared_ptr<slab> current_slab;
+    // shared with the slabs, which may outlive the arena
+    shared_ptr<std::atomic<long>> live_slab_count;
+};
+
+#endif //INSTANCE_ARENA_H
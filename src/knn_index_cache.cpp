@@ -0,0 +1,105 @@
+#include "knn_index_cache.h"
+
+knn_index_cache::knn_index_cache(const knn_index_cache& rhs) :
+        search(rhs.search),
+        num_trees(rhs.num_trees),
+        leaf_size(rhs.leaf_size) {}
+
+void knn_index_cache::set_search(neighbour_search_enum search, int num_trees, int leaf_size) {
+    this->search = search;
+    this->num_trees = num_trees;
+    this->leaf_size = leaf_size;
+    entries.clear();
+}
+
+void knn_index_cache::query(const columnar_store& store,
+                            const vector<int>& att_indices,
+                            const Eigen::MatrixXd& queries,
+                            int k,
+                            knn::Matrixi& indices) {
+    size_t num_rows = store.size();
+    int num_queries = queries.cols();
+    k = std::min<size_t>(k, num_rows);
+
+    unique_ptr<entry>& cur_entry = entries[att_indices];
+    if (cur_entry == nullptr) {
+        cur_entry = make_unique<entry>();
+    }
+    if (cur_entry->num_indexed_rows == 0
+        || cur_entry->num_indexed_rows > num_rows
+        || 4 * (num_rows - cur_entry->num_indexed_rows) > num_rows) {
+        build(*cur_entry, store, att_indices);
+    }
+
+    Eigen::MatrixXd distances;
+    cur_entry->index->query(queries, k, indices, distances);
+
+    // rows appended since the last build
+    int num_dims = att_indices.size() + 1;
+    for (size_t row = cur_entry->num_indexed_rows; row < num_rows; row++) {
+        for (int q = 0; q < num_queries; q++) {
+            double distance = 0;
+            for (int d = 0; d < num_dims; d++) {
+                double diff = project_value(store, row, att_indices, d) - queries(d, q);
+                distance += diff * diff;
+            }
+            distance = sqrt(distance);
+
+            // results are sorted by distance, insert in place
+            int pos = k;
+            while (pos > 0 && (indices(pos - 1, q) < 0 || distance < distances(pos - 1, q))) {
+                pos--;
+            }
+            if (pos == k) {
+                continue;
+            }
+            for (int i = k - 1; i > pos; i--) {
+                indices(i, q) = indices(i - 1, q);
+                distances(i, q) = distances(i - 1, q);
+            }
+            indices(pos, q) = row;
+            distances(pos, q) = distance;
+        }
+    }
+}
+
+void knn_index_cache::build(entry& cur_entry, const columnar_store& store, const vector<int>& att_indices) {
+    size_t num_rows = store.size();
+    int num_dims = att_indices.size() + 1;
+
+    cur_entry.data_points.resize(num_dims, num_rows);
+    for (size_t row = 0; row < num_rows; row++) {
+        for (int d = 0; d < num_dims; d++) {
+            cur_entry.data_points(d, row) = project_value(store, row, att_indices, d);
+        }
+    }
+
+    cur_entry.index = neighbour_index::make(search, num_trees, leaf_size);
+    cur_entry.index->build(cur_entry.data_points);
+
+    cur_entry.num_indexed_rows = num_rows;
+    rebuild_count++;
+}
+
+// the label is the last dimension
+double knn_index_cache::project_value(const columnar_store& store,
+                                      size_t row,
+                                      const vector<int>& att_indices,
+                                      int dim) {
+    if (dim == att_indices.size()) {
+        return store.get_label(row);
+    }
+    return store.get_value(row, att_indices[dim]);
+}
+
+void knn_index_cache::clear() {
+    entries.clear();
+}
+
+int knn_index_cache::get_num_indices() const {
+    return entries.size();
+}
+
+long knn_index_cache::get_rebuild_count() const {
+    return rebuild_count;
+}
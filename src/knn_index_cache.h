@@ -0,0 +1,53 @@
+#ifndef KNN_INDEX_CACHE_H
+#define KNN_INDEX_CACHE_H
+
+#include "columnar_store.h"
+#include "neighbour_index.h"
+
+// Neighbour indices over the rows of one columnar_store, one per attribute
+// projection.
+// A point is the row's values at the projected attributes followed by its
+// label. An index is built on first use of a projection and kept; rows
+// appended afterwards are scanned linearly and merged into the results until
+// they make up a quarter of the store, then the index is rebuilt in bulk.
+class knn_index_cache {
+public:
+    knn_index_cache() = default;
+    // copies the search settings, indices are rebuilt on demand
+    knn_index_cache(const knn_index_cache& rhs);
+
+    // drops existing indices, exact kdtree by default
+    void set_search(neighbour_search_enum search, int num_trees, int leaf_size);
+
+    // queries holds one projected point per column, result column i holds the
+    // store indices of the k rows closest to query i
+    void query(const columnar_store& store,
+               const vector<int>& att_indices,
+               const Eigen::MatrixXd& queries,
+               int k,
+               knn::Matrixi& indices);
+
+    void clear();
+    int get_num_indices() const;
+    long get_rebuild_count() const;
+
+private:
+    struct entry {
+        // the index references data_points, entries never move
+        Eigen::MatrixXd data_points;
+        unique_ptr<neighbour_index> index;
+        size_t num_indexed_rows = 0;
+    };
+
+    neighbour_search_enum search = neighbour_search_enum::kdtree_search;
+    int num_trees = 8;
+    int leaf_size = 32;
+
+    std::map<vector<int>, unique_ptr<entry>> entries;
+    long rebuild_count = 0;
+
+    void build(entry& cur_entry, const columnar_store& store, const vector<int>& att_indices);
+    static double project_value(const columnar_store& store, size_t row, const vector<int>& att_indices, int dim);
+};
+
+#endif //KNN_INDEX_CACHE_H
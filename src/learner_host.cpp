@@ -0,0 +1,316 @@
+#include "learner_host.h"
+
+learner_host::learner_host(int num_workers,
+                           int quantum,
+                           int hibernate_after_millis,
+                           std::function<shared_ptr<trans_tree>()> make_learner) :
+        quantum(quantum),
+        hibernate_after_millis(hibernate_after_millis),
+        make_learner(make_learner) {
+
+    if (num_workers < 1 || quantum < 1) {
+        cout << "learner_host: num_workers and quantum must be positive" << endl;
+        exit(1);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        workers.push_back(std::thread(&learner_host::run_worker, this));
+    }
+    if (hibernate_after_millis > 0) {
+        housekeeper = std::thread(&learner_host::run_housekeeping, this);
+    }
+}
+
+learner_host::~learner_host() {
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    housekeeping_wakeup.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (housekeeper.joinable()) {
+        housekeeper.join();
+    }
+}
+
+void learner_host::add_tenant(const string& tenant_id, const string& group_id) {
+    std::unique_lock<std::mutex> lock(schedule_mutex);
+
+    if (tenants.find(tenant_id) != tenants.end()) {
+        cout << "learner_host: duplicate tenant " << tenant_id << endl;
+        exit(1);
+    }
+
+    string cur_group_id = group_id.empty() ? "tenant:" + tenant_id : group_id;
+    if (groups.find(cur_group_id) == groups.end()) {
+        groups[cur_group_id] = make_unique<tenant_group>();
+        groups[cur_group_id]->id = cur_group_id;
+    }
+    tenant_group* group = groups[cur_group_id].get();
+
+    // the members' registered pools must not change under a running worker
+    group_released.wait(lock, [group] { return !group->scheduled; });
+
+    unique_ptr<tenant> new_tenant = make_unique<tenant>();
+    new_tenant->id = tenant_id;
+    new_tenant->group = group;
+    new_tenant->learner = make_learner();
+    new_tenant->memory_estimate = new_tenant->learner->get_memory_estimate();
+    new_tenant->last_active = std::chrono::steady_clock::now();
+
+    for (auto member : group->members) {
+        new_tenant->learner->register_tree_pool(member->learner->get_concept_repo());
+        member->learner->register_tree_pool(new_tenant->learner->get_concept_repo());
+    }
+
+    group->members.push_back(new_tenant.get());
+    tenants[tenant_id] = std::move(new_tenant);
+}
+
+void learner_host::submit(const string& tenant_id, Instance* instance) {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+
+    tenant* cur_tenant = find_tenant(tenant_id);
+    cur_tenant->pending.push_back(cur_tenant->arena.adopt(instance));
+    pending_count++;
+
+    if (!cur_tenant->ready) {
+        cur_tenant->ready = true;
+        cur_tenant->group->ready_tenants.push_back(cur_tenant);
+    }
+
+    tenant_group* group = cur_tenant->group;
+    if (!group->scheduled) {
+        group->scheduled = true;
+        ready_groups.push_back(group);
+        work_available.notify_one();
+    }
+}
+
+void learner_host::init_data_source(const string& tenant_id, const string& filename) {
+    unique_ptr<Reader> reader = make_unique<ArffReader>();
+    if (!reader->setFile(filename)) {
+        cout << "Failed to open file: " << filename << endl;
+        exit(1);
+    }
+
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+    find_tenant(tenant_id)->reader = std::move(reader);
+}
+
+bool learner_host::submit_next(const string& tenant_id) {
+    Reader* reader;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        reader = find_tenant(tenant_id)->reader.get();
+    }
+    if (reader == nullptr) {
+        cout << "learner_host: no data source for tenant " << tenant_id << endl;
+        exit(1);
+    }
+
+    if (!reader->hasNextInstance()) {
+        return false;
+    }
+    submit(tenant_id, reader->nextInstance());
+    return true;
+}
+
+void learner_host::flush() {
+    std::unique_lock<std::mutex> lock(schedule_mutex);
+    work_drained.wait(lock, [this] { return pending_count == 0; });
+}
+
+long learner_host::get_memory_estimate(const string& tenant_id) {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+    return find_tenant(tenant_id)->memory_estimate;
+}
+
+long learner_host::get_total_memory_estimate() {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+
+    long total = 0;
+    for (auto& entry : tenants) {
+        total += entry.second->memory_estimate;
+    }
+    return total;
+}
+
+// processed, correct, pending, memory estimate, hibernated
+vector<long> learner_host::get_tenant_stats(const string& tenant_id) {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+
+    tenant* cur_tenant = find_tenant(tenant_id);
+    return {
+        cur_tenant->processed_count,
+        cur_tenant->correct_count,
+        (long) cur_tenant->pending.size(),
+        cur_tenant->memory_estimate,
+        (long) cur_tenant->hibernated
+    };
+}
+
+int learner_host::get_num_hibernated() {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+
+    int count = 0;
+    for (auto& entry : tenants) {
+        count += (int) entry.second->hibernated;
+    }
+    return count;
+}
+
+// schedule_mutex must be held
+learner_host::tenant* learner_host::find_tenant(const string& tenant_id) {
+    auto entry = tenants.find(tenant_id);
+    if (entry == tenants.end()) {
+        cout << "learner_host: unknown tenant " << tenant_id << endl;
+        exit(1);
+    }
+    return entry->second.get();
+}
+
+// schedule_mutex must be held
+void learner_host::release_group(tenant_group* group) {
+    if (!group->ready_tenants.empty()) {
+        ready_groups.push_back(group);
+        work_available.notify_one();
+        return;
+    }
+
+    group->scheduled = false;
+    group_released.notify_all();
+}
+
+void learner_host::run_worker() {
+    std::unique_lock<std::mutex> lock(schedule_mutex);
+
+    while (true) {
+        work_available.wait(lock, [this] { return stopping || !ready_groups.empty(); });
+        if (ready_groups.empty()) {
+            return;
+        }
+
+        tenant_group* group = ready_groups.front();
+        ready_groups.pop_front();
+        tenant* cur_tenant = group->ready_tenants.front();
+        group->ready_tenants.pop_front();
+
+        vector<shared_ptr<Instance>> batch;
+        while (batch.size() < quantum && !cur_tenant->pending.empty()) {
+            batch.push_back(cur_tenant->pending.front());
+            cur_tenant->pending.pop_front();
+        }
+        if (cur_tenant->pending.empty()) {
+            cur_tenant->ready = false;
+        } else {
+            group->ready_tenants.push_back(cur_tenant);
+        }
+
+        lock.unlock();
+
+        // the group is held: no other thread touches its learners
+        long correct_count = 0;
+        for (auto& instance : batch) {
+            if (cur_tenant->learner->predict_instance(instance.get()) == instance->getLabel()) {
+                correct_count++;
+            }
+            cur_tenant->learner->train_instance(instance);
+        }
+
+        long memory_estimate = -1;
+        if (cur_tenant->processed_count + (long) batch.size() - cur_tenant->last_accounted_count
+                >= accounting_interval) {
+            memory_estimate = cur_tenant->learner->get_memory_estimate();
+        }
+
+        lock.lock();
+
+        cur_tenant->processed_count += batch.size();
+        cur_tenant->correct_count += correct_count;
+        cur_tenant->hibernated = false;
+        cur_tenant->last_active = std::chrono::steady_clock::now();
+        if (memory_estimate >= 0) {
+            cur_tenant->memory_estimate = memory_estimate;
+            cur_tenant->last_accounted_count = cur_tenant->processed_count;
+        }
+
+        pending_count -= batch.size();
+        release_group(group);
+        if (pending_count == 0) {
+            work_drained.notify_all();
+        }
+    }
+}
+
+void learner_host::run_housekeeping() {
+    std::unique_lock<std::mutex> lock(schedule_mutex);
+    auto idle_limit = std::chrono::milliseconds(hibernate_after_millis);
+    auto sweep_interval = std::chrono::milliseconds(std::max(hibernate_after_millis / 4, 1));
+
+    while (!stopping) {
+        housekeeping_wakeup.wait_for(lock, sweep_interval);
+        if (stopping) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        vector<tenant*> idle_tenants;
+        vector<tenant_group*> held_groups;
+
+        for (auto& entry : groups) {
+            tenant_group* group = entry.second.get();
+            if (group->scheduled) {
+                continue;
+            }
+
+            bool held = false;
+            for (auto member : group->members) {
+                if (!member->hibernated
+                    && member->processed_count > 0
+                    && now - member->last_active >= idle_limit) {
+                    idle_tenants.push_back(member);
+                    held = true;
+                }
+            }
+
+            if (held) {
+                // keep workers off the group without queueing it
+                group->scheduled = true;
+                held_groups.push_back(group);
+            }
+        }
+
+        if (idle_tenants.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+
+        // a learner in the middle of a transfer stays awake until the next sweep
+        vector<bool> hibernated;
+        vector<long> memory_estimates;
+        for (auto idle_tenant : idle_tenants) {
+            hibernated.push_back(idle_tenant->learner->hibernate());
+            memory_estimates.push_back(hibernated.back() ? idle_tenant->learner->get_memory_estimate() : -1);
+        }
+
+        lock.lock();
+
+        for (int i = 0; i < idle_tenants.size(); i++) {
+            if (hibernated[i]) {
+                idle_tenants[i]->hibernated = true;
+                idle_tenants[i]->memory_estimate = memory_estimates[i];
+            }
+        }
+        for (auto group : held_groups) {
+            release_group(group);
+        }
+    }
+}
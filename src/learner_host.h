@@ -0,0 +1,112 @@
+#ifndef LEARNER_HOST_H
+#define LEARNER_HOST_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "trans_tree.h"
+
+// Runs one trans_tree learner per tenant stream on a shared pool of workers.
+//
+// Tenants that share concepts are placed in the same group: their tree pools
+// are registered with each other on arrival, so wiring grows with group size
+// rather than with the number of tenants. Because match_concept reads the
+// trees of the other members, a group is the unit of scheduling: at most one
+// worker runs a group at a time, and different groups run in parallel.
+// Tenants without a group get a group of their own.
+//
+// Scheduling is round robin: a worker takes the next ready group, runs up to
+// `quantum` pending instances of the group's next ready tenant (test then
+// train), and puts the group back at the tail of the queue if more work is
+// pending.
+//
+// A housekeeping thread hibernates learners that have been idle for longer
+// than `hibernate_after_millis` (<= 0 disables). A hibernated learner is
+// woken transparently when its tenant receives an instance.
+class learner_host {
+public:
+    learner_host(int num_workers,
+                 int quantum,
+                 int hibernate_after_millis,
+                 std::function<shared_ptr<trans_tree>()> make_learner);
+    ~learner_host();
+
+    void add_tenant(const string& tenant_id, const string& group_id);
+    // the host takes ownership of the instance
+    void submit(const string& tenant_id, Instance* instance);
+    // a tenant's stream is read on the thread calling submit_next, which
+    // returns false once the stream is exhausted
+    void init_data_source(const string& tenant_id, const string& filename);
+    bool submit_next(const string& tenant_id);
+    // blocks until every submitted instance has been processed
+    void flush();
+
+    long get_memory_estimate(const string& tenant_id);
+    long get_total_memory_estimate();
+    // processed, correct, pending, memory estimate, hibernated
+    vector<long> get_tenant_stats(const string& tenant_id);
+    int get_num_hibernated();
+
+    // re-estimate a tenant's memory after this many processed instances
+    int accounting_interval = 1000;
+
+private:
+    struct tenant_group;
+
+    struct tenant {
+        string id;
+        tenant_group* group;
+        shared_ptr<trans_tree> learner;
+        unique_ptr<Reader> reader;
+        // submit() runs under schedule_mutex, so adoption stays single-threaded
+        instance_arena arena;
+
+        deque<shared_ptr<Instance>> pending;
+        bool ready = false;
+
+        long processed_count = 0;
+        long correct_count = 0;
+        long memory_estimate = 0;
+        long last_accounted_count = 0;
+        bool hibernated = false;
+        std::chrono::steady_clock::time_point last_active;
+    };
+
+    struct tenant_group {
+        string id;
+        vector<tenant*> members;
+        deque<tenant*> ready_tenants;
+        // set while the group is queued or held by a worker
+        bool scheduled = false;
+    };
+
+    int quantum;
+    int hibernate_after_millis;
+    std::function<shared_ptr<trans_tree>()> make_learner;
+
+    std::map<string, unique_ptr<tenant>> tenants;
+    std::map<string, unique_ptr<tenant_group>> groups;
+
+    // guards the maps, the queues and the scheduling flags
+    std::mutex schedule_mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_drained;
+    std::condition_variable group_released;
+    std::condition_variable housekeeping_wakeup;
+    deque<tenant_group*> ready_groups;
+    long pending_count = 0;
+    bool stopping = false;
+
+    vector<std::thread> workers;
+    std::thread housekeeper;
+
+    tenant* find_tenant(const string& tenant_id);
+    void release_group(tenant_group* group);
+    void run_worker();
+    void run_housekeeping();
+};
+
+#endif //LEARNER_HOST_H
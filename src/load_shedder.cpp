@@ -0,0 +1,119 @@
+#include "load_shedder.h"
+
+load_shedder::load_shedder() {}
+
+void load_shedder::set_target_rate(double target_rate) {
+    if (target_rate <= 0) {
+        enabled = false;
+        level = 0;
+        foreground_keep_ratio = 1.0;
+        return;
+    }
+
+    enabled = true;
+    budget_micros = 1000000.0 / target_rate;
+}
+
+bool load_shedder::is_enabled() const {
+    return enabled;
+}
+
+void load_shedder::begin_instance() {
+    if (!enabled) {
+        return;
+    }
+    instance_start_time = std::chrono::steady_clock::now();
+}
+
+void load_shedder::end_instance() {
+    if (!enabled) {
+        return;
+    }
+
+    double elapsed_micros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - instance_start_time).count();
+
+    if (instance_count == 0) {
+        ewma_micros = elapsed_micros;
+    } else {
+        ewma_micros = ewma_alpha * elapsed_micros + (1 - ewma_alpha) * ewma_micros;
+    }
+
+    instance_count++;
+    if (instance_count % adjust_interval == 0) {
+        adjust_level();
+    }
+}
+
+void load_shedder::adjust_level() {
+    if (ewma_micros > budget_micros) {
+        if (level < max_level) {
+            level++;
+        } else {
+            // already shedding everything else, keep fewer foreground updates
+            foreground_keep_ratio = std::max(min_foreground_keep_ratio,
+                                             foreground_keep_ratio * budget_micros / ewma_micros);
+        }
+
+    } else if (ewma_micros < release_ratio * budget_micros && level > 0) {
+        if (level == max_level && foreground_keep_ratio < 1.0) {
+            foreground_keep_ratio = std::min(1.0, foreground_keep_ratio * 2);
+        } else {
+            level--;
+        }
+    }
+}
+
+bool load_shedder::skip_replay() {
+    if (!enabled || level < 1) {
+        return false;
+    }
+    shed_replay_count++;
+    return true;
+}
+
+bool load_shedder::skip_perf_eval() {
+    if (!enabled || level < 2) {
+        return false;
+    }
+    shed_perf_eval_count++;
+    return true;
+}
+
+bool load_shedder::skip_background() {
+    if (!enabled || level < 3) {
+        return false;
+    }
+    shed_background_count++;
+    return true;
+}
+
+bool load_shedder::skip_foreground() {
+    if (!enabled || level < max_level) {
+        return false;
+    }
+
+    // deterministic subsampling: keep an update whenever the credit reaches one
+    foreground_credit += foreground_keep_ratio;
+    if (foreground_credit >= 1.0) {
+        foreground_credit -= 1.0;
+        return false;
+    }
+
+    shed_foreground_count++;
+    return true;
+}
+
+int load_shedder::get_level() const {
+    return level;
+}
+
+vector<long> load_shedder::get_stats() const {
+    return {
+        level,
+        shed_replay_count,
+        shed_perf_eval_count,
+        shed_background_count,
+        shed_foreground_count
+    };
+}
@@ -0,0 +1,65 @@
+#ifndef LOAD_SHEDDER_H
+#define LOAD_SHEDDER_H
+
+#include <chrono>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Keeps training at a target rate under sustained overload by progressively
+// skipping the least valuable work. Levels are cumulative:
+//   1: skip source-instance replay
+//   2: skip performance evaluation of the boosted pool
+//   3: skip background tree training
+//   4: subsample foreground training
+// The controller compares an EWMA of the per-instance training time against
+// the time budget implied by the target rate and moves one level at a time,
+// with hysteresis so that a level is only released once the cost has dropped
+// well below the budget.
+class load_shedder {
+public:
+    load_shedder();
+
+    // target_rate in instances per second, <= 0 disables shedding
+    void set_target_rate(double target_rate);
+    bool is_enabled() const;
+
+    void begin_instance();
+    void end_instance();
+
+    bool skip_replay();
+    bool skip_perf_eval();
+    bool skip_background();
+    bool skip_foreground();
+
+    int get_level() const;
+    // level, shed replays, shed perf_evals, shed background updates, shed foreground updates
+    vector<long> get_stats() const;
+
+    static const int max_level = 4;
+
+private:
+    bool enabled = false;
+    double budget_micros = 0;
+    double ewma_micros = 0;
+    double ewma_alpha = 0.05;
+    double release_ratio = 0.6;
+    int adjust_interval = 100;
+    long instance_count = 0;
+    int level = 0;
+
+    // fraction of foreground updates kept at the last level
+    double foreground_keep_ratio = 1.0;
+    double min_foreground_keep_ratio = 0.1;
+    double foreground_credit = 0;
+
+    long shed_replay_count = 0;
+    long shed_perf_eval_count = 0;
+    long shed_background_count = 0;
+    long shed_foreground_count = 0;
+
+    std::chrono::steady_clock::time_point instance_start_time;
+
+    void adjust_level();
+};
+
+#endif //LOAD_SHEDDER_H
@@ -22,7 +22,7 @@ from collections import deque
 import numpy as np
 
 from evaluator import Evaluator
-from trans_pearl_wrapper import adaptive_random_forest, pearl, trans_pearl_wrapper, trans_tree_wrapper
+from trans_pearl_wrapper import adaptive_random_forest, pearl, trans_pearl_wrapper, trans_tree_wrapper, learner_host
 
 formatter = logging.Formatter('%(message)s')
 
@@ -82,6 +82,89 @@ if __name__ == '__main__':
                         dest="boost_mode", default="otradaboost", type=str,
                         help="no_boost, ozaboost, tradaboost, otradaboost")
 
+    # serving params
+    parser.add_argument("--snapshot_max_instances",
+                        dest="snapshot_max_instances", default=0, type=int,
+                        help="Predict from a model snapshot refreshed at least every n trained instances")
+    parser.add_argument("--snapshot_max_millis",
+                        dest="snapshot_max_millis", default=0, type=int,
+                        help="Predict from a model snapshot refreshed at least every n milliseconds")
+    parser.add_argument("--async_queue_size",
+                        dest="async_queue_size", default=0, type=int,
+                        help="Train on a background thread fed by a queue of this size (0 trains inline)")
+    parser.add_argument("--async_overflow_policy",
+                        dest="async_overflow_policy", default="block", type=str,
+                        help="block, drop, subsample")
+    parser.add_argument("--target_train_rate",
+                        dest="target_train_rate", default=0, type=float,
+                        help="Shed transfer work to keep training at this many instances per second (0 disables)")
+    parser.add_argument("--instance_store_encoding",
+                        dest="instance_store_encoding", default="float64", type=str,
+                        choices=["float64", "float32", "uint16", "uint8"],
+                        help="Column encoding of the per-tree instance stores")
+    parser.add_argument("--spill_threshold_mb",
+                        dest="spill_threshold_mb", default=0, type=int,
+                        help="Spill archived instance stores to disk above this learner size in MB (0 disables)")
+    parser.add_argument("--instance_summary_size",
+                        dest="instance_summary_size", default=0, type=int,
+                        help="Replay a weighted coreset of at most n representatives per tree "
+                             "instead of the raw instance store (0 disables)")
+    parser.add_argument("--tree_backend",
+                        dest="tree_backend", default="streamdm", type=str,
+                        help="streamdm or compact, compact trees keep their nodes in a per-tree arena")
+    parser.add_argument("--deferred_reclamation",
+                        dest="deferred_reclamation", action="store_true",
+                        help="Destroy discarded trees and transfer pools on a low-priority background thread")
+    parser.add_argument("--pool_drift_detector",
+                        dest="pool_drift_detector", default="adwin", type=str,
+                        help="Drift detector of transfer pool members: adwin, ddm, eddm or hddm_a")
+    parser.add_argument("--tree_memory_budget_kb",
+                        dest="tree_memory_budget_kb", default=0, type=int,
+                        help="Memory budget of live nodes and leaf statistics of each compact tree, "
+                             "least promising leaves are deactivated beyond it (0 disables)")
+    parser.add_argument("--pool_memory_budget_kb",
+                        dest="pool_memory_budget_kb", default=0, type=int,
+                        help="Memory budget shared by the compact trees of a transfer pool (0 disables)")
+    parser.add_argument("--shared_pool_observations",
+                        dest="shared_pool_observations", action="store_true",
+                        help="Unsplit compact trees of a transfer pool record instances once in a shared log")
+    parser.add_argument("--discretize_bins",
+                        dest="discretize_bins", default=0, type=int,
+                        help="Discretize attributes into n quantile bins (at most 256, 0 disables), fit on the "
+                             "first stream's first instances and shared by all streams, "
+                             "compact trees use histogram observers")
+    parser.add_argument("--observer_isa",
+                        dest="observer_isa", default="auto", type=str,
+                        help="Kernel of compact tree observer updates: auto, scalar or avx2")
+    parser.add_argument("--adaptive_grace_period",
+                        dest="adaptive_grace_period", action="store_true",
+                        help="Compact tree leaves skip split attempts the Hoeffding bound rules out")
+    parser.add_argument("--split_workers",
+                        dest="split_workers", default=0, type=int,
+                        help="Threads evaluating compact tree split attempts, 0 evaluates them inline")
+    parser.add_argument("--attribute_workers",
+                        dest="attribute_workers", default=0, type=int,
+                        help="Extra threads sharing the attributes of wide compact tree leaves, 0 disables")
+    parser.add_argument("--attribute_parallel_threshold",
+                        dest="attribute_parallel_threshold", default=200, type=int,
+                        help="Leaves observing at least this many attributes use the attribute workers")
+    parser.add_argument("--replay_batch_size",
+                        dest="replay_batch_size", default=0, type=int,
+                        help="no_boost pools train on replayed source instances in batches of n, "
+                             "trees are the same as with 0 (one at a time)")
+
+    # hosting params
+    parser.add_argument("--host_workers",
+                        dest="host_workers", default=0, type=int,
+                        help="Run each stream as a tenant of a learner host with n worker threads, "
+                             "tenants use the default learner settings (0 disables)")
+    parser.add_argument("--host_quantum",
+                        dest="host_quantum", default=100, type=int,
+                        help="Instances a host worker runs for one tenant before moving on")
+    parser.add_argument("--hibernate_after_millis",
+                        dest="hibernate_after_millis", default=0, type=int,
+                        help="Hibernate tenants idle for longer than n milliseconds (0 disables)")
+
     # real world datasets
     parser.add_argument("--dataset_name",
                         dest="dataset_name", default="", type=str,
@@ -236,6 +319,31 @@ if __name__ == '__main__':
             print("unsupported boost mode")
             exit(1)
 
+        if args.instance_summary_size > 0:
+            result_directory = f"{result_directory}/summary-{args.instance_summary_size}/"
+
+        if args.tree_backend != "streamdm":
+            result_directory = f"{result_directory}/{args.tree_backend}-tree/"
+
+        if args.pool_drift_detector != "adwin":
+            result_directory = f"{result_directory}/{args.pool_drift_detector}-pool/"
+
+        if args.tree_memory_budget_kb > 0 or args.pool_memory_budget_kb > 0:
+            result_directory = f"{result_directory}/budget-{args.tree_memory_budget_kb}-" \
+                               f"{args.pool_memory_budget_kb}kb/"
+
+        if args.shared_pool_observations:
+            result_directory = f"{result_directory}/shared-pool/"
+
+        if args.discretize_bins > 0:
+            result_directory = f"{result_directory}/bins-{args.discretize_bins}/"
+
+        if args.adaptive_grace_period:
+            result_directory = f"{result_directory}/adaptive-grace/"
+
+        if args.host_workers > 0:
+            result_directory = f"{result_directory}/host-{args.host_workers}-{args.hibernate_after_millis}ms/"
+
         if args.is_generated_data:
             result_directory = f"{result_directory}/{args.generator_seed}/"
 
@@ -251,7 +359,10 @@ if __name__ == '__main__':
                              f"result-stream-{idx}.csv"
         print(metric_output_file)
         metrics_logger = setup_logger(f'metrics-{idx}', metric_output_file)
-        metrics_logger.info("count,accuracy,kappa,candidate_tree_size,transferred_tree_count,tree_pool_size,time")
+        if args.host_workers > 0:
+            metrics_logger.info("count,accuracy,memory_estimate,hibernated,time")
+        else:
+            metrics_logger.info("count,accuracy,kappa,candidate_tree_size,transferred_tree_count,tree_pool_size,time")
         metrics_loggers.append(metrics_logger)
 
     # TODO
@@ -311,6 +422,29 @@ if __name__ == '__main__':
 
         #         all_f.write(",".join([str(v) for v in all_predicted_drift_locs[i]]))
         #         all_f.write("\n")
+    elif args.transfer_tree and args.host_workers > 0:
+        classifier = learner_host(args.host_workers,
+                                  args.host_quantum,
+                                  args.hibernate_after_millis,
+                                  args.random_state,
+                                  args.kappa_window,
+                                  args.warning_delta,
+                                  args.drift_delta,
+                                  args.least_transfer_warning_period_instances_length,
+                                  args.instance_store_size,
+                                  args.num_diff_distr_instances,
+                                  args.bbt_pool_size,
+                                  args.eviction_interval,
+                                  args.transfer_kappa_threshold,
+                                  args.transfer_gamma,
+                                  args.transfer_match_lowerbound,
+                                  args.boost_mode)
+
+        # the streams share concepts, so they share a group like the wrapper's classifiers
+        tenant_ids = [f"stream-{i}" for i in range(len(data_file_path.split(";")))]
+        for tenant_id in tenant_ids:
+            classifier.add_tenant(tenant_id, "streams")
+
     elif args.transfer_tree:
         classifier = trans_tree_wrapper(len(data_file_path.split(";")),
                                          args.random_state,
@@ -348,6 +482,110 @@ if __name__ == '__main__':
                       args.warning_delta,
                       args.drift_delta)
 
+    predict_from_snapshot = args.snapshot_max_instances > 0 or args.snapshot_max_millis > 0
+    if args.host_workers > 0:
+        if not args.transfer_tree:
+            exit("hosting is only supported with --transfer_tree")
+        # tenants are built with the learner's default settings and served by the host's workers
+        for setting in ["snapshot_max_instances", "snapshot_max_millis", "async_queue_size", "target_train_rate",
+                        "instance_store_encoding", "spill_threshold_mb", "instance_summary_size", "tree_backend",
+                        "deferred_reclamation", "pool_drift_detector", "tree_memory_budget_kb",
+                        "pool_memory_budget_kb", "shared_pool_observations", "discretize_bins", "observer_isa",
+                        "adaptive_grace_period", "split_workers", "attribute_workers", "replay_batch_size"]:
+            if getattr(args, setting) != parser.get_default(setting):
+                exit(f"--{setting} is not supported with --host_workers")
+    if predict_from_snapshot:
+        classifier.set_snapshot_staleness(args.snapshot_max_instances, args.snapshot_max_millis)
+
+    if args.target_train_rate > 0:
+        if not args.transfer and not args.transfer_tree:
+            exit("load shedding requires --transfer or --transfer_tree")
+        classifier.set_load_shedding(args.target_train_rate)
+
+    if (args.transfer or args.transfer_tree) and args.host_workers == 0:
+        classifier.set_instance_store_encoding(args.instance_store_encoding)
+
+    if args.spill_threshold_mb > 0:
+        if not args.transfer_tree:
+            exit("spilling instance stores is only supported with --transfer_tree")
+        classifier.set_spill_threshold(args.spill_threshold_mb * 1024 * 1024)
+
+    if args.instance_summary_size > 0:
+        if not args.transfer_tree:
+            exit("instance summaries are only supported with --transfer_tree")
+        classifier.set_instance_summary_size(args.instance_summary_size)
+
+    if args.tree_backend != "streamdm":
+        if not args.transfer_tree:
+            exit("tree backends are only supported with --transfer_tree")
+        classifier.set_tree_backend(args.tree_backend)
+
+    if args.deferred_reclamation:
+        if not args.transfer_tree:
+            exit("deferred reclamation is only supported with --transfer_tree")
+        classifier.set_deferred_reclamation(True)
+
+    if args.pool_drift_detector != "adwin":
+        if not args.transfer_tree:
+            exit("pool drift detectors are only supported with --transfer_tree")
+        classifier.set_pool_drift_detector(args.pool_drift_detector)
+
+    if args.tree_memory_budget_kb > 0 or args.pool_memory_budget_kb > 0:
+        if not args.transfer_tree:
+            exit("memory budgets are only supported with --transfer_tree")
+        if args.tree_backend != "compact":
+            exit("memory budgets are only supported with --tree_backend compact")
+        classifier.set_memory_budget(args.tree_memory_budget_kb * 1024, args.pool_memory_budget_kb * 1024)
+
+    if args.shared_pool_observations:
+        if not args.transfer_tree:
+            exit("shared pool observations are only supported with --transfer_tree")
+        if args.tree_backend != "compact":
+            exit("shared pool observations are only supported with --tree_backend compact")
+        classifier.set_shared_pool_observations(True)
+
+    if args.discretize_bins > 0:
+        if not args.transfer_tree:
+            exit("discretization is only supported with --transfer_tree")
+        classifier.set_discretization(args.discretize_bins)
+
+    if args.observer_isa != "auto":
+        if not args.transfer_tree:
+            exit("observer kernels are only supported with --transfer_tree")
+        classifier.set_observer_isa(args.observer_isa)
+
+    if args.adaptive_grace_period:
+        if not args.transfer_tree:
+            exit("the adaptive grace period is only supported with --transfer_tree")
+        if args.tree_backend != "compact":
+            exit("the adaptive grace period is only supported with --tree_backend compact")
+        classifier.set_adaptive_grace_period(True)
+
+    if args.split_workers > 0:
+        if not args.transfer_tree:
+            exit("split workers are only supported with --transfer_tree")
+        if args.tree_backend != "compact":
+            exit("split workers are only supported with --tree_backend compact")
+        classifier.set_split_workers(args.split_workers)
+
+    if args.attribute_workers > 0:
+        if not args.transfer_tree:
+            exit("attribute workers are only supported with --transfer_tree")
+        if args.tree_backend != "compact":
+            exit("attribute workers are only supported with --tree_backend compact")
+        classifier.set_attribute_workers(args.attribute_workers, args.attribute_parallel_threshold)
+
+    if args.replay_batch_size > 0:
+        if not args.transfer_tree:
+            exit("replay batches are only supported with --transfer_tree")
+        classifier.set_replay_batch_size(args.replay_batch_size)
+
+    if args.async_queue_size > 0:
+        if not args.transfer_tree:
+            exit("async training is only supported with --transfer_tree")
+        # predictions are served from snapshots, train() only enqueues
+        classifier.enable_async_training(args.async_queue_size, args.async_overflow_policy)
+
     # data_file_list = []
     # for file_path in data_file_path.split(";"):
     #     data_file_list.append(f'{file_path}/{args.generator_seed}.arff')
@@ -364,6 +602,17 @@ if __name__ == '__main__':
 
 
     evaluator = Evaluator()
+    if args.host_workers > 0:
+        evaluator.prequential_evaluation_host(
+            host=classifier,
+            tenant_ids=tenant_ids,
+            data_file_paths=data_file_list,
+            sample_freq=args.sample_freq,
+            metrics_loggers=metrics_loggers)
+        print(f"hibernated tenants: {classifier.get_num_hibernated()}, "
+              f"total memory estimate: {classifier.get_total_memory_estimate()}")
+        exit()
+
     evaluator.prequential_evaluation_transfer(
         classifier=classifier,
         data_file_paths=data_file_list,
@@ -371,5 +620,16 @@ if __name__ == '__main__':
         sample_freq=args.sample_freq,
         metrics_loggers=metrics_loggers,
         expected_drift_locs_list=expected_drift_locs_list,
-        acc_per_drift_logger=acc_per_drift_logger)
+        acc_per_drift_logger=acc_per_drift_logger,
+        predict_from_snapshot=predict_from_snapshot)
+
+    if args.async_queue_size > 0:
+        enqueued, trained, dropped, subsampled, lag, max_lag = classifier.get_training_queue_stats()
+        print(f"training queue: enqueued {enqueued}, trained {trained}, dropped {dropped}, "
+              f"subsampled {subsampled}, lag {lag}, max lag {max_lag}")
+
+    if args.target_train_rate > 0:
+        level, replay, perf_eval, background, foreground = classifier.get_load_shedding_stats()
+        print(f"load shedding: level {level}, shed replay {replay}, perf_eval {perf_eval}, "
+              f"background {background}, foreground {foreground}")
 
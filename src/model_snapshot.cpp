@@ -0,0 +1,146 @@
+#include <unordered_map>
+
+#include "model_snapshot.h"
+
+std::atomic<long> model_snapshot::next_snapshot_id(0);
+
+model_snapshot::model_snapshot(long instance_count) :
+        snapshot_id(next_snapshot_id.fetch_add(1)),
+        alive(make_shared<int>(0)),
+        instance_count(instance_count),
+        prebuilt_claimed(false) {}
+
+// the first reader's copies are built right away
+void model_snapshot::add_tree(HT::HoeffdingTree& tree) {
+    tree_states.push_back(serialize_tree(tree));
+    prebuilt_trees.push_back(deserialize_tree(tree_states.back()));
+}
+
+void model_snapshot::add_tree(compact_hoeffding_tree& tree) {
+    compact_trees.push_back(make_unique<compact_hoeffding_tree>(tree));
+}
+
+int model_snapshot::predict_tree(HT::HoeffdingTree& tree, Instance& instance) {
+    double* classPredictions = tree.getPrediction(instance);
+    int result = 0;
+    double max_val = classPredictions[0];
+
+    // Find class label with the highest probability
+    for (int i = 1; i < instance.getNumberClasses(); i++) {
+        if (max_val < classPredictions[i]) {
+            max_val = classPredictions[i];
+            result = i;
+        }
+    }
+
+    return result;
+}
+
+// snapshot ids are never reused, so a cached copy cannot be mistaken for
+// one of a later snapshot allocated at the same address
+model_snapshot::tree_set& model_snapshot::get_reader_trees() const {
+    static thread_local std::unordered_map<long, reader_copy> reader_copies;
+
+    auto cached = reader_copies.find(snapshot_id);
+    if (cached != reader_copies.end()) {
+        return cached->second.trees;
+    }
+
+    for (auto it = reader_copies.begin(); it != reader_copies.end();) {
+        if (it->second.snapshot_alive.expired()) {
+            it = reader_copies.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    reader_copy& copy = reader_copies[snapshot_id];
+    copy.snapshot_alive = alive;
+    if (!prebuilt_claimed.exchange(true)) {
+        copy.trees = std::move(prebuilt_trees);
+    } else {
+        for (auto& state : tree_states) {
+            copy.trees.push_back(deserialize_tree(state));
+        }
+    }
+    return copy.trees;
+}
+
+int model_snapshot::predict(Instance& instance) const {
+    if (compact_trees.size() == 1 && tree_states.empty()) {
+        return compact_trees[0]->predict(instance);
+    }
+
+    tree_set empty_trees;
+    tree_set& trees = tree_states.empty() ? empty_trees : get_reader_trees();
+
+    int result;
+    if (trees.size() == 1 && compact_trees.empty()) {
+        result = predict_tree(*trees[0], instance);
+    } else {
+        vector<int> votes(instance.getNumberClasses(), 0);
+        for (auto& tree : trees) {
+            votes[predict_tree(*tree, instance)]++;
+        }
+        for (auto& tree : compact_trees) {
+            votes[tree->predict(instance)]++;
+        }
+        result = std::max_element(votes.begin(), votes.end()) - votes.begin();
+    }
+
+    return result;
+}
+
+long model_snapshot::get_instance_count() const {
+    return instance_count;
+}
+
+int model_snapshot::get_tree_count() const {
+    return tree_states.size() + compact_trees.size();
+}
+
+// class snapshot_policy
+snapshot_policy::snapshot_policy() {
+    last_publish_time = std::chrono::steady_clock::now();
+}
+
+void snapshot_policy::set_staleness(int max_instances, int max_millis) {
+    if (max_instances <= 0 && max_millis <= 0) {
+        cout << "snapshot staleness needs an instance or time bound" << endl;
+        exit(1);
+    }
+
+    this->enabled = true;
+    this->max_instances = max_instances;
+    this->max_millis = max_millis;
+}
+
+bool snapshot_policy::is_enabled() const {
+    return enabled;
+}
+
+bool snapshot_policy::on_train() {
+    if (!enabled) {
+        return false;
+    }
+
+    instances_since_publish++;
+    if (max_instances > 0 && instances_since_publish >= max_instances) {
+        return true;
+    }
+
+    if (max_millis > 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - last_publish_time);
+        if (elapsed.count() >= max_millis) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void snapshot_policy::on_publish() {
+    instances_since_publish = 0;
+    last_publish_time = std::chrono::steady_clock::now();
+}
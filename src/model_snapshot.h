@@ -0,0 +1,78 @@
+#ifndef MODEL_SNAPSHOT_H
+#define MODEL_SNAPSHOT_H
+
+#include <atomic>
+#include <chrono>
+
+#include "rcu_snapshot.h"
+#include "tree_serialization.h"
+#include "compact_hoeffding_tree.h"
+
+// Immutable copy of the trees a learner predicts with.
+// A snapshot is built by the training thread and only read afterwards,
+// so any number of threads may call predict() on it concurrently.
+// streamDM's getPrediction writes into the tree, so the streamDM trees are
+// kept serialized and every reading thread predicts with copies of its own,
+// cached per thread and looked up without locking.
+class model_snapshot {
+public:
+    explicit model_snapshot(long instance_count);
+
+    void add_tree(HT::HoeffdingTree& tree);
+    void add_tree(compact_hoeffding_tree& tree);
+
+    // single tree: argmax of its class votes
+    // ensemble: majority vote over the trees
+    int predict(Instance& instance) const;
+
+    long get_instance_count() const;
+    int get_tree_count() const;
+
+private:
+    typedef vector<unique_ptr<HT::HoeffdingTree>> tree_set;
+
+    struct reader_copy {
+        // expires with the snapshot, so copies of retired snapshots can be dropped
+        std::weak_ptr<int> snapshot_alive;
+        tree_set trees;
+    };
+
+    static std::atomic<long> next_snapshot_id;
+
+    long snapshot_id;
+    shared_ptr<int> alive;
+    long instance_count;
+    vector<string> tree_states;
+    vector<unique_ptr<compact_hoeffding_tree>> compact_trees;
+
+    // built by the training thread and handed to the first reader
+    mutable tree_set prebuilt_trees;
+    mutable std::atomic<bool> prebuilt_claimed;
+
+    tree_set& get_reader_trees() const;
+    static int predict_tree(HT::HoeffdingTree& tree, Instance& instance);
+};
+
+// Decides when a learner republishes its snapshot.
+// Staleness is bounded by the number of instances trained since the last
+// publish and, optionally, by wall clock time.
+class snapshot_policy {
+public:
+    snapshot_policy();
+
+    void set_staleness(int max_instances, int max_millis);
+    bool is_enabled() const;
+
+    // called once per trained instance, returns true when a refresh is due
+    bool on_train();
+    void on_publish();
+
+private:
+    bool enabled = false;
+    int max_instances = 1000;
+    int max_millis = -1;
+    long instances_since_publish = 0;
+    std::chrono::steady_clock::time_point last_publish_time;
+};
+
+#endif //MODEL_SNAPSHOT_H
@@ -0,0 +1,106 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free ring buffer for many producers and a single consumer.
+// Each cell carries a sequence number that tells producers whether the slot
+// is free for position pos and tells the consumer whether it has been filled,
+// so neither side ever takes a lock.
+// The capacity is rounded up to the next power of two.
+template <typename T>
+class mpsc_ring {
+public:
+    explicit mpsc_ring(size_t min_capacity) {
+        capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+
+        cells.reset(new cell[capacity]);
+        for (size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+    // returns false when the ring is full
+    bool try_push(T value) {
+        cell* cur_cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+            cur_cell = &cells[pos & mask];
+            size_t seq = cur_cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cur_cell->data = std::move(value);
+        cur_cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side only, returns false when the ring is empty
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        cell* cur_cell = &cells[pos & mask];
+        size_t seq = cur_cell->sequence.load(std::memory_order_acquire);
+
+        if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) {
+            return false;
+        }
+
+        value = std::move(cur_cell->data);
+        cur_cell->data = T();
+        cur_cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate under concurrent pushes
+    size_t size() const {
+        size_t tail = dequeue_pos.load(std::memory_order_acquire);
+        size_t head = enqueue_pos.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : 0;
+    }
+
+    size_t get_capacity() const {
+        return capacity;
+    }
+
+private:
+    struct cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    size_t capacity;
+    size_t mask;
+    std::unique_ptr<cell[]> cells;
+
+    // keep the producer and consumer cursors on separate cache lines
+    char pad0[64];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[64];
+    std::atomic<size_t> dequeue_pos;
+    char pad2[64];
+};
+
+#endif //MPSC_RING_H
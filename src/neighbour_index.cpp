@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "neighbour_index.h"
+
+neighbour_search_enum parse_neighbour_search(const string& search_str) {
+    static const std::map<string, neighbour_search_enum> neighbour_search_map =
+            {
+                    { "kdtree", neighbour_search_enum::kdtree_search },
+                    { "rp_forest", neighbour_search_enum::rp_forest_search },
+            };
+
+    auto entry = neighbour_search_map.find(search_str);
+    if (entry == neighbour_search_map.end()) {
+        cout << "Invalid neighbour search backend: " << search_str << endl;
+        exit(1);
+    }
+    return entry->second;
+}
+
+unique_ptr<neighbour_index> neighbour_index::make(neighbour_search_enum search, int num_trees, int leaf_size) {
+    switch (search) {
+        case neighbour_search_enum::kdtree_search:
+            return make_unique<kdtree_index>();
+        case neighbour_search_enum::rp_forest_search:
+            return make_unique<rp_forest_index>(num_trees, leaf_size);
+        default:
+            cout << "neighbour_index: unknown search backend" << endl;
+            exit(1);
+    }
+}
+
+// class kdtree_index
+void kdtree_index::build(const Eigen::MatrixXd& data_points) {
+    kdtree.setData(data_points);
+    kdtree.setBucketSize(16);
+    kdtree.setCompact(false);
+    kdtree.setBalanced(false);
+    kdtree.setTakeRoot(true);
+    kdtree.setMaxDistance(0);
+    kdtree.setThreads(2);
+    kdtree.build();
+}
+
+void kdtree_index::query(const Eigen::MatrixXd& queries,
+                         int k,
+                         knn::Matrixi& indices,
+                         Eigen::MatrixXd& distances) const {
+    kdtree.query(queries, k, indices, distances);
+}
+
+// class rp_forest_index
+rp_forest_index::rp_forest_index(int num_trees, int leaf_size) :
+        num_trees(num_trees),
+        leaf_size(leaf_size),
+        mrand(42) {
+
+    if (num_trees < 1 || leaf_size < 1) {
+        cout << "rp_forest_index: num_trees and leaf_size must be positive" << endl;
+        exit(1);
+    }
+}
+
+void rp_forest_index::build(const Eigen::MatrixXd& data_points) {
+    this->data_points = &data_points;
+    nodes.clear();
+    roots.clear();
+    normals.clear();
+    points.clear();
+
+    int num_points = data_points.cols();
+    for (int t = 0; t < num_trees; t++) {
+        int begin = points.size();
+        for (int i = 0; i < num_points; i++) {
+            points.push_back(i);
+        }
+        roots.push_back(build_node(begin, points.size(), 0));
+    }
+}
+
+int rp_forest_index::build_node(int begin, int end, int depth) {
+    int node_idx = nodes.size();
+    nodes.emplace_back();
+
+    // the depth limit guards against runs of identical points
+    if (end - begin <= leaf_size || depth >= 64) {
+        nodes[node_idx].leaf_begin = begin;
+        nodes[node_idx].leaf_end = end;
+        return node_idx;
+    }
+
+    const Eigen::MatrixXd& data = *data_points;
+    int num_dims = data.rows();
+
+    std::uniform_int_distribution<int> point_distr(begin, end - 1);
+    int lhs = points[point_distr(mrand)];
+    int rhs = points[point_distr(mrand)];
+
+    long normal_offset = normals.size();
+    double threshold = 0;
+    for (int d = 0; d < num_dims; d++) {
+        double normal = data(d, lhs) - data(d, rhs);
+        normals.push_back(normal);
+        threshold += normal * (data(d, lhs) + data(d, rhs)) / 2;
+    }
+
+    auto above = [&](int point) {
+        double projection = 0;
+        for (int d = 0; d < num_dims; d++) {
+            projection += normals[normal_offset + d] * data(d, point);
+        }
+        return projection > threshold;
+    };
+    int mid = std::partition(points.begin() + begin, points.begin() + end, above) - points.begin();
+
+    if (mid == begin || mid == end) {
+        // degenerate hyperplane, split in half
+        mid = begin + (end - begin) / 2;
+    }
+
+    nodes[node_idx].normal_offset = normal_offset;
+    nodes[node_idx].threshold = threshold;
+    int left = build_node(begin, mid, depth + 1);
+    int right = build_node(mid, end, depth + 1);
+    nodes[node_idx].left = left;
+    nodes[node_idx].right = right;
+    return node_idx;
+}
+
+int rp_forest_index::descend(int node_idx, const double* query) const {
+    int num_dims = data_points->rows();
+
+    while (nodes[node_idx].normal_offset != -1) {
+        const node& cur_node = nodes[node_idx];
+        double projection = 0;
+        for (int d = 0; d < num_dims; d++) {
+            projection += normals[cur_node.normal_offset + d] * query[d];
+        }
+        node_idx = projection > cur_node.threshold ? cur_node.left : cur_node.right;
+    }
+    return node_idx;
+}
+
+void rp_forest_index::query(const Eigen::MatrixXd& queries,
+                            int k,
+                            knn::Matrixi& indices,
+                            Eigen::MatrixXd& distances) const {
+    const Eigen::MatrixXd& data = *data_points;
+    int num_queries = queries.cols();
+
+    indices.setConstant(k, num_queries, -1);
+    distances.setConstant(k, num_queries, std::numeric_limits<double>::infinity());
+
+    vector<int> candidates;
+    vector<std::pair<double, int>> ranked;
+    for (int q = 0; q < num_queries; q++) {
+        const double* query = queries.data() + q * queries.rows();
+
+        candidates.clear();
+        for (int root : roots) {
+            const node& leaf = nodes[descend(root, query)];
+            candidates.insert(candidates.end(), points.begin() + leaf.leaf_begin, points.begin() + leaf.leaf_end);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        ranked.clear();
+        for (int candidate : candidates) {
+            ranked.emplace_back((data.col(candidate) - queries.col(q)).norm(), candidate);
+        }
+        int num_found = std::min<int>(k, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + num_found, ranked.end());
+
+        for (int i = 0; i < num_found; i++) {
+            distances(i, q) = ranked[i].first;
+            indices(i, q) = ranked[i].second;
+        }
+    }
+}
+
+vector<double> benchmark_neighbour_search(const string& filename,
+                                          int store_size,
+                                          int num_queries,
+                                          int num_trees,
+                                          int leaf_size) {
+    ArffReader reader;
+    if (!reader.setFile(filename)) {
+        cout << "Failed to open file: " << filename << endl;
+        exit(1);
+    }
+
+    vector<vector<double>> points;
+    while (points.size() < store_size + num_queries && reader.hasNextInstance()) {
+        unique_ptr<Instance> instance(reader.nextInstance());
+        vector<double> point;
+        for (int j = 0; j < instance->getNumberInputAttributes(); j++) {
+            point.push_back(instance->getInputAttributeValue(j));
+        }
+        point.push_back(instance->getLabel());
+        points.push_back(point);
+    }
+    if (points.size() < store_size + num_queries) {
+        cout << "benchmark_neighbour_search: " << filename << " has fewer than "
+             << store_size + num_queries << " instances" << endl;
+        exit(1);
+    }
+
+    int num_dims = points[0].size();
+    Eigen::MatrixXd data_points(num_dims, store_size);
+    Eigen::MatrixXd queries(num_dims, num_queries);
+    for (int i = 0; i < store_size + num_queries; i++) {
+        for (int d = 0; d < num_dims; d++) {
+            if (i < store_size) {
+                data_points(d, i) = points[i][d];
+            } else {
+                queries(d, i - store_size) = points[i][d];
+            }
+        }
+    }
+
+    vector<knn::Matrixi> indices(2);
+    vector<double> timings;
+    int search_idx = 0;
+    for (auto search : { neighbour_search_enum::kdtree_search, neighbour_search_enum::rp_forest_search }) {
+        unique_ptr<neighbour_index> index = neighbour_index::make(search, num_trees, leaf_size);
+        Eigen::MatrixXd distances;
+
+        auto start = std::chrono::steady_clock::now();
+        index->build(data_points);
+        auto built = std::chrono::steady_clock::now();
+        index->query(queries, 1, indices[search_idx], distances);
+        auto queried = std::chrono::steady_clock::now();
+
+        timings.push_back(std::chrono::duration<double, std::milli>(built - start).count());
+        timings.push_back(std::chrono::duration<double, std::micro>(queried - built).count() / num_queries);
+        search_idx++;
+    }
+
+    // distances are recomputed, ties between stored points are not misses
+    int recalled = 0;
+    for (int q = 0; q < num_queries; q++) {
+        int exact_idx = indices[0](0, q);
+        int approx_idx = indices[1](0, q);
+        if (approx_idx < 0) {
+            continue;
+        }
+        double exact_distance = (data_points.col(exact_idx) - queries.col(q)).norm();
+        double approx_distance = (data_points.col(approx_idx) - queries.col(q)).norm();
+        if (approx_distance <= exact_distance * (1 + 1e-9)) {
+            recalled++;
+        }
+    }
+
+    vector<double> results;
+    results.push_back((double) recalled / num_queries);
+    results.insert(results.end(), timings.begin(), timings.end());
+    return results;
+}
@@ -0,0 +1,101 @@
+#ifndef NEIGHBOUR_INDEX_H
+#define NEIGHBOUR_INDEX_H
+
+#include <random>
+
+#include "knn-cpp/include/knn/kdtree_minkowski.h"
+
+#include <streamDM/streams/ArffReader.h>
+
+#include "splittable_rng.h"
+
+enum class neighbour_search_enum { kdtree_search, rp_forest_search };
+neighbour_search_enum parse_neighbour_search(const string& search_str);
+
+// Nearest-neighbour search over a fixed set of points, one point per column.
+// The index references the points passed to build(), which must outlive it.
+// Result column i holds the columns of the k points closest to query i, in
+// increasing Euclidean distance; -1 marks a missing neighbour.
+class neighbour_index {
+public:
+    virtual ~neighbour_index() = default;
+
+    virtual void build(const Eigen::MatrixXd& data_points) = 0;
+    virtual void query(const Eigen::MatrixXd& queries,
+                       int k,
+                       knn::Matrixi& indices,
+                       Eigen::MatrixXd& distances) const = 0;
+
+    // kdtree, or rp_forest with num_trees trees; more trees raise recall and latency
+    static unique_ptr<neighbour_index> make(neighbour_search_enum search, int num_trees, int leaf_size);
+};
+
+// exact search through knn-cpp
+class kdtree_index : public neighbour_index {
+public:
+    void build(const Eigen::MatrixXd& data_points) override;
+    void query(const Eigen::MatrixXd& queries,
+               int k,
+               knn::Matrixi& indices,
+               Eigen::MatrixXd& distances) const override;
+
+private:
+    knn::KDTreeMinkowski<double, knn::EuclideanDistance<double>> kdtree;
+};
+
+// Approximate search with a forest of random projection trees.
+// Each tree splits its points recursively by the hyperplane bisecting two
+// randomly drawn points until at most leaf_size remain. A query descends to
+// one leaf per tree, and the union of those leaves is ranked exactly, so the
+// cost is bounded by num_trees * leaf_size distance computations whatever the
+// store size and dimensionality.
+class rp_forest_index : public neighbour_index {
+public:
+    rp_forest_index(int num_trees, int leaf_size);
+
+    void build(const Eigen::MatrixXd& data_points) override;
+    void query(const Eigen::MatrixXd& queries,
+               int k,
+               knn::Matrixi& indices,
+               Eigen::MatrixXd& distances) const override;
+
+private:
+    struct node {
+        // internal nodes: hyperplane normal at normals[normal_offset], leaves: -1
+        long normal_offset = -1;
+        double threshold = 0;
+        int left = -1;
+        int right = -1;
+        // leaves: points[leaf_begin, leaf_end)
+        int leaf_begin = 0;
+        int leaf_end = 0;
+    };
+
+    int num_trees;
+    int leaf_size;
+    splittable_rng mrand;
+
+    const Eigen::MatrixXd* data_points = nullptr;
+    vector<node> nodes;
+    vector<int> roots;
+    vector<double> normals;
+    vector<int> points;
+
+    int build_node(int begin, int end, int depth);
+    int descend(int node_idx, const double* query) const;
+};
+
+// Recall and latency of rp_forest against exact kdtree search on a stream:
+// the first store_size instances of the ARFF file are indexed, the next
+// num_queries are the queries. A point is an instance's attribute values
+// followed by its label, as in the trees' instance stores. A query is
+// recalled when its approximate neighbour is as close as the exact one.
+// Returns recall, then build millis and query micros per query of kdtree and
+// of rp_forest.
+vector<double> benchmark_neighbour_search(const string& filename,
+                                          int store_size,
+                                          int num_queries,
+                                          int num_trees,
+                                          int leaf_size);
+
+#endif //NEIGHBOUR_INDEX_H
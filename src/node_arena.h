@@ -0,0 +1,82 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for the nodes and leaf statistics of one tree.
+// Memory is carved out of geometrically growing chunks and only returned all
+// at once, when the arena is released or destroyed, so tearing down a tree
+// costs one free per chunk instead of one per node. Objects allocated here
+// are never destructed and must be trivially destructible.
+class node_arena {
+public:
+    explicit node_arena(size_t first_chunk_bytes = 4096) :
+            next_chunk_bytes(first_chunk_bytes) {}
+
+    node_arena(const node_arena&) = delete;
+    node_arena& operator=(const node_arena&) = delete;
+
+    // zero-initialized storage for count objects of type T
+    template <typename T>
+    T* allocate(size_t count = 1) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "node_arena never runs destructors");
+        void* ptr = allocate_bytes(count * sizeof(T), alignof(T));
+        memset(ptr, 0, count * sizeof(T));
+        return static_cast<T*>(ptr);
+    }
+
+    void release() {
+        chunks.clear();
+        cursor = nullptr;
+        chunk_end = nullptr;
+        reserved_bytes = 0;
+        used_bytes = 0;
+    }
+
+    long get_reserved_bytes() const {
+        return reserved_bytes;
+    }
+
+    long get_used_bytes() const {
+        return used_bytes;
+    }
+
+private:
+    static const size_t max_chunk_bytes = 1 << 20;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* cursor = nullptr;
+    char* chunk_end = nullptr;
+    size_t next_chunk_bytes;
+    long reserved_bytes = 0;
+    long used_bytes = 0;
+
+    void* allocate_bytes(size_t bytes, size_t alignment) {
+        uintptr_t aligned = ((uintptr_t) cursor + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        if (cursor == nullptr || aligned + bytes > (uintptr_t) chunk_end) {
+            size_t chunk_bytes = next_chunk_bytes;
+            while (chunk_bytes < bytes + alignment) {
+                chunk_bytes *= 2;
+            }
+            chunks.emplace_back(new char[chunk_bytes]);
+            cursor = chunks.back().get();
+            chunk_end = cursor + chunk_bytes;
+            reserved_bytes += chunk_bytes;
+            if (next_chunk_bytes < max_chunk_bytes) {
+                next_chunk_bytes *= 2;
+            }
+            aligned = ((uintptr_t) cursor + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        }
+
+        cursor = (char*) (aligned + bytes);
+        used_bytes += bytes;
+        return (void*) aligned;
+    }
+};
+
+#endif //NODE_ARENA_H
@@ -0,0 +1,234 @@
+#include "observer_kernels.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OBSERVER_KERNELS_X86
+#endif
+
+namespace {
+
+typedef void (*gaussian_kernel)(int, const int*, const double*, double, double*, double*, double*, double*, double*);
+
+// std::min and std::max keep the observer's value when value is NaN, as
+// _mm256_min_pd and _mm256_max_pd do with value as their first operand
+void update_gaussian_scalar(int num_tracked,
+                            const int* tracked_atts,
+                            const double* values,
+                            double weight,
+                            double* weights,
+                            double* means,
+                            double* m2s,
+                            double* mins,
+                            double* maxs) {
+    for (int i = 0; i < num_tracked; i++) {
+        double value = tracked_atts != nullptr ? values[tracked_atts[i]] : values[i];
+        double new_weight = weights[i] + weight;
+        double delta = value - means[i];
+        means[i] += delta * weight / new_weight;
+        m2s[i] += weight * delta * (value - means[i]);
+        weights[i] = new_weight;
+        mins[i] = std::min(mins[i], value);
+        maxs[i] = std::max(maxs[i], value);
+    }
+}
+
+#ifdef OBSERVER_KERNELS_X86
+// same operations in the same order as the scalar kernel, without FMA
+__attribute__((target("avx2")))
+void update_gaussian_avx2(int num_tracked,
+                          const int* tracked_atts,
+                          const double* values,
+                          double weight,
+                          double* weights,
+                          double* means,
+                          double* m2s,
+                          double* mins,
+                          double* maxs) {
+    __m256d weight_vec = _mm256_set1_pd(weight);
+    int i = 0;
+    for (; i + 4 <= num_tracked; i += 4) {
+        __m256d value;
+        if (tracked_atts != nullptr) {
+            __m128i idx = _mm_loadu_si128((const __m128i*) (tracked_atts + i));
+            value = _mm256_i32gather_pd(values, idx, sizeof(double));
+        } else {
+            value = _mm256_loadu_pd(values + i);
+        }
+
+        __m256d new_weight = _mm256_add_pd(_mm256_loadu_pd(weights + i), weight_vec);
+        __m256d mean = _mm256_loadu_pd(means + i);
+        __m256d delta = _mm256_sub_pd(value, mean);
+        mean = _mm256_add_pd(mean, _mm256_div_pd(_mm256_mul_pd(delta, weight_vec), new_weight));
+        __m256d m2_step = _mm256_mul_pd(_mm256_mul_pd(weight_vec, delta), _mm256_sub_pd(value, mean));
+
+        _mm256_storeu_pd(means + i, mean);
+        _mm256_storeu_pd(m2s + i, _mm256_add_pd(_mm256_loadu_pd(m2s + i), m2_step));
+        _mm256_storeu_pd(weights + i, new_weight);
+        _mm256_storeu_pd(mins + i, _mm256_min_pd(value, _mm256_loadu_pd(mins + i)));
+        _mm256_storeu_pd(maxs + i, _mm256_max_pd(value, _mm256_loadu_pd(maxs + i)));
+    }
+    // the compiler leaves the upper halves dirty before the tail call, which
+    // stalls the SSE code running after it
+    _mm256_zeroupper();
+
+    update_gaussian_scalar(num_tracked - i,
+                           tracked_atts != nullptr ? tracked_atts + i : nullptr,
+                           tracked_atts != nullptr ? values : values + i,
+                           weight,
+                           weights + i,
+                           means + i,
+                           m2s + i,
+                           mins + i,
+                           maxs + i);
+}
+#endif
+
+gaussian_kernel select_gaussian_kernel(observer_isa_enum isa) {
+#ifdef OBSERVER_KERNELS_X86
+    if (isa == observer_isa_enum::avx2_isa) {
+        return update_gaussian_avx2;
+    }
+#endif
+    return update_gaussian_scalar;
+}
+
+observer_isa_enum best_supported_isa() {
+    if (is_observer_isa_supported(observer_isa_enum::avx2_isa)) {
+        return observer_isa_enum::avx2_isa;
+    }
+    return observer_isa_enum::scalar_isa;
+}
+
+std::atomic<observer_isa_enum> current_isa(best_supported_isa());
+std::atomic<gaussian_kernel> current_gaussian_kernel(select_gaussian_kernel(current_isa));
+
+}
+
+observer_isa_enum parse_observer_isa(const string& isa_str) {
+    static const std::map<string, observer_isa_enum> isa_map =
+            {
+                    { "scalar", observer_isa_enum::scalar_isa },
+                    { "avx2", observer_isa_enum::avx2_isa },
+            };
+
+    if (isa_str == "auto") {
+        return best_supported_isa();
+    }
+    auto entry = isa_map.find(isa_str);
+    if (entry == isa_map.end()) {
+        cout << "Invalid observer ISA: " << isa_str << endl;
+        exit(1);
+    }
+    return entry->second;
+}
+
+bool is_observer_isa_supported(observer_isa_enum isa) {
+    switch (isa) {
+        case observer_isa_enum::scalar_isa:
+            return true;
+        case observer_isa_enum::avx2_isa:
+#ifdef OBSERVER_KERNELS_X86
+            // may run during static initialization, before the runtime sets up cpu features
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+void set_observer_isa(observer_isa_enum isa) {
+    if (!is_observer_isa_supported(isa)) {
+        cout << "set_observer_isa: the CPU does not support the requested ISA" << endl;
+        exit(1);
+    }
+    current_isa = isa;
+    current_gaussian_kernel = select_gaussian_kernel(isa);
+}
+
+observer_isa_enum get_observer_isa() {
+    return current_isa;
+}
+
+void update_gaussian_observers(int num_tracked,
+                               const int* tracked_atts,
+                               const double* values,
+                               double weight,
+                               double* weights,
+                               double* means,
+                               double* m2s,
+                               double* mins,
+                               double* maxs) {
+    current_gaussian_kernel.load(std::memory_order_relaxed)(
+            num_tracked, tracked_atts, values, weight, weights, means, m2s, mins, maxs);
+}
+
+vector<double> benchmark_observer_kernels(int num_attributes, bool tracked_subset, int num_updates) {
+    const int num_rows = 1024;
+    std::mt19937 rng(0);
+    std::normal_distribution<double> value_dist(0, 1);
+    vector<double> rows(num_rows * num_attributes);
+    for (double& value : rows) {
+        value = value_dist(rng);
+    }
+
+    vector<int> tracked_atts;
+    if (tracked_subset) {
+        for (int i = 0; i < num_attributes; i += 2) {
+            tracked_atts.push_back(i);
+        }
+    }
+    int num_tracked = tracked_subset ? tracked_atts.size() : num_attributes;
+
+    // weights, means, m2s, mins and maxs of each kernel
+    vector<vector<double>> results;
+    vector<double> timings;
+    for (auto isa : { observer_isa_enum::scalar_isa, observer_isa_enum::avx2_isa }) {
+        if (!is_observer_isa_supported(isa)) {
+            timings.push_back(-1);
+            continue;
+        }
+
+        gaussian_kernel kernel = select_gaussian_kernel(isa);
+        vector<double> columns(5 * num_tracked, 0);
+        double* weights = columns.data();
+        double* means = weights + num_tracked;
+        double* m2s = means + num_tracked;
+        double* mins = m2s + num_tracked;
+        double* maxs = mins + num_tracked;
+        std::fill(mins, mins + num_tracked, std::numeric_limits<double>::max());
+        std::fill(maxs, maxs + num_tracked, std::numeric_limits<double>::lowest());
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_updates; i++) {
+            kernel(num_tracked,
+                   tracked_subset ? tracked_atts.data() : nullptr,
+                   rows.data() + (i % num_rows) * num_attributes,
+                   1.0,
+                   weights,
+                   means,
+                   m2s,
+                   mins,
+                   maxs);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        timings.push_back(std::chrono::duration<double, std::nano>(end - start).count() / num_updates);
+        results.push_back(columns);
+    }
+
+    if (results.size() == 2
+        && memcmp(results[0].data(), results[1].data(), results[0].size() * sizeof(double)) != 0) {
+        cout << "benchmark_observer_kernels: the scalar and AVX2 kernels disagree" << endl;
+        exit(1);
+    }
+
+    return timings;
+}
@@ -0,0 +1,37 @@
+#ifndef OBSERVER_KERNELS_H
+#define OBSERVER_KERNELS_H
+
+#include <streamDM/streams/ArffReader.h>
+
+// Updates of the per-class Gaussian observer arrays of compact tree leaves,
+// one pass over all observed attributes. The AVX2 kernel handles four
+// attributes per step and is picked at runtime when the CPU supports it;
+// both kernels round identically, so trees do not depend on the machine.
+enum class observer_isa_enum { scalar_isa, avx2_isa };
+// "auto" picks the best ISA the CPU supports
+observer_isa_enum parse_observer_isa(const string& isa_str);
+
+// process-wide, AVX2 is refused on CPUs without it
+void set_observer_isa(observer_isa_enum isa);
+observer_isa_enum get_observer_isa();
+bool is_observer_isa_supported(observer_isa_enum isa);
+
+// weighted Welford update of attribute tracked_atts[i] (i when tracked_atts
+// is null) into column i of each array
+void update_gaussian_observers(int num_tracked,
+                               const int* tracked_atts,
+                               const double* values,
+                               double weight,
+                               double* weights,
+                               double* means,
+                               double* m2s,
+                               double* mins,
+                               double* maxs);
+
+// Nanos per update of one leaf's observers over num_attributes attributes,
+// for the scalar kernel and then the AVX2 kernel (-1 when the CPU lacks it).
+// With tracked_subset every second attribute is tracked through tracked_atts,
+// which the AVX2 kernel gathers. Exits if the kernels' results differ.
+vector<double> benchmark_observer_kernels(int num_attributes, bool tracked_subset, int num_updates);
+
+#endif //OBSERVER_KERNELS_H
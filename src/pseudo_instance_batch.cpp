@@ -0,0 +1,84 @@
+#include "pseudo_instance_batch.h"
+
+void pseudo_instance_batch::reset(int num_attributes, int capacity) {
+    this->num_attributes = num_attributes;
+    this->capacity = capacity;
+    mask_words = (num_attributes + 63) / 64;
+    num_rows = 0;
+
+    values.resize((size_t) num_attributes * capacity);
+    labels.resize(capacity);
+    modified_masks.resize((size_t) mask_words * capacity);
+}
+
+int pseudo_instance_batch::append(DenseInstance& generated) {
+    if (num_rows >= capacity) {
+        cout << "pseudo_instance_batch: batch is full" << endl;
+        exit(1);
+    }
+
+    int row = num_rows++;
+    for (int i = 0; i < num_attributes; i++) {
+        values[(size_t) i * capacity + row] = generated.getInputAttributeValue(i);
+    }
+    labels[row] = generated.getLabel();
+
+    uint64_t* mask = &modified_masks[(size_t) row * mask_words];
+    std::fill(mask, mask + mask_words, 0);
+    for (int att_idx : generated.modifiedAttIndices) {
+        mask[att_idx / 64] |= (uint64_t) 1 << (att_idx % 64);
+    }
+    return row;
+}
+
+int pseudo_instance_batch::size() const {
+    return num_rows;
+}
+
+int pseudo_instance_batch::get_num_attributes() const {
+    return num_attributes;
+}
+
+double pseudo_instance_batch::get_value(int row, int att_idx) const {
+    return values[(size_t) att_idx * capacity + row];
+}
+
+void pseudo_instance_batch::set_value(int row, int att_idx, double value) {
+    values[(size_t) att_idx * capacity + row] = value;
+}
+
+int pseudo_instance_batch::get_label(int row) const {
+    return labels[row];
+}
+
+bool pseudo_instance_batch::is_modified(int row, int att_idx) const {
+    return (modified_masks[(size_t) row * mask_words + att_idx / 64] >> (att_idx % 64)) & 1;
+}
+
+bool pseudo_instance_batch::same_modified_attributes(int lhs_row, int rhs_row) const {
+    const uint64_t* lhs = &modified_masks[(size_t) lhs_row * mask_words];
+    const uint64_t* rhs = &modified_masks[(size_t) rhs_row * mask_words];
+    return std::equal(lhs, lhs + mask_words, rhs);
+}
+
+bool pseudo_instance_batch::modified_attributes_less(int lhs_row, int rhs_row) const {
+    const uint64_t* lhs = &modified_masks[(size_t) lhs_row * mask_words];
+    const uint64_t* rhs = &modified_masks[(size_t) rhs_row * mask_words];
+    return std::lexicographical_compare(lhs, lhs + mask_words, rhs, rhs + mask_words);
+}
+
+void pseudo_instance_batch::materialize(int row,
+                                        DenseInstance& view,
+                                        InstanceInformation* instance_information) const {
+    view.mInputData.resize(num_attributes);
+    view.modifiedAttIndices.clear();
+    for (int i = 0; i < num_attributes; i++) {
+        view.mInputData[i] = get_value(row, i);
+        if (is_modified(row, i)) {
+            view.modifiedAttIndices.push_back(i);
+        }
+    }
+    view.mOutputData.assign(1, (double) labels[row]);
+    view.setInstanceInformation(instance_information);
+    view.setWeight(1);
+}
@@ -0,0 +1,44 @@
+#ifndef PSEUDO_INSTANCE_BATCH_H
+#define PSEUDO_INSTANCE_BATCH_H
+
+#include <cstdint>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Pseudo-instances generated in one pass, stored column by column.
+// The attributes a generating tree assigned are kept as a per-row bitmask,
+// the remaining ones are filled in from a neighbour afterwards. Buffers only
+// grow, so a batch reused across drifts stops allocating once it has seen
+// its largest size.
+class pseudo_instance_batch {
+public:
+    // drops all rows
+    void reset(int num_attributes, int capacity);
+    // copies the generated values, label and modified attributes, returns the row
+    int append(DenseInstance& generated);
+
+    int size() const;
+    int get_num_attributes() const;
+
+    double get_value(int row, int att_idx) const;
+    void set_value(int row, int att_idx, double value);
+    int get_label(int row) const;
+    bool is_modified(int row, int att_idx) const;
+    // rows with equal masks share a neighbour projection
+    bool same_modified_attributes(int lhs_row, int rhs_row) const;
+    bool modified_attributes_less(int lhs_row, int rhs_row) const;
+
+    void materialize(int row, DenseInstance& view, InstanceInformation* instance_information) const;
+
+private:
+    int num_attributes = 0;
+    int capacity = 0;
+    int num_rows = 0;
+    int mask_words = 0;
+
+    vector<double> values; // values[att_idx * capacity + row]
+    vector<int> labels;
+    vector<uint64_t> modified_masks; // mask_words per row
+};
+
+#endif //PSEUDO_INSTANCE_BATCH_H
@@ -0,0 +1,123 @@
+#include "quantile_discretizer.h"
+
+quantile_discretizer::quantile_discretizer(int num_bins, int warmup_instances) :
+        num_bins(num_bins),
+        warmup_instances(warmup_instances) {
+
+    if (num_bins < 2 || num_bins > UINT8_MAX + 1) {
+        cout << "quantile_discretizer: num_bins must be within [2, 256]" << endl;
+        exit(1);
+    }
+    if (warmup_instances < 1) {
+        cout << "quantile_discretizer: warmup_instances must be positive" << endl;
+        exit(1);
+    }
+}
+
+void quantile_discretizer::init_attributes(int num_attributes) {
+    if (cut_points.empty()) {
+        samples.resize(num_attributes);
+        cut_points.resize(num_attributes);
+    } else if (num_attributes != cut_points.size()) {
+        cout << "quantile_discretizer: expected " << cut_points.size()
+             << " attributes, got " << num_attributes << endl;
+        exit(1);
+    }
+}
+
+void quantile_discretizer::observe(Instance& instance) {
+    if (frozen) {
+        cout << "quantile_discretizer: cut points are already frozen" << endl;
+        exit(1);
+    }
+
+    int num_attributes = instance.getNumberInputAttributes();
+    init_attributes(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        double value = instance.getInputAttributeValue(i);
+        if (!std::isnan(value)) {
+            samples[i].push_back(value);
+        }
+    }
+    num_seen++;
+    if (num_seen >= warmup_instances) {
+        freeze();
+    }
+}
+
+void quantile_discretizer::freeze() {
+    if (frozen) {
+        return;
+    }
+    refit();
+    frozen = true;
+    vector<vector<double>>().swap(samples);
+}
+
+void quantile_discretizer::discretize(DenseInstance& instance) {
+    if (!frozen) {
+        cout << "quantile_discretizer: cut points are not frozen yet" << endl;
+        exit(1);
+    }
+
+    int num_attributes = instance.getNumberInputAttributes();
+    init_attributes(num_attributes);
+    for (int i = 0; i < num_attributes; i++) {
+        double value = instance.mInputData[i];
+        if (std::isnan(value)) {
+            continue;
+        }
+        const vector<double>& cuts = cut_points[i];
+        instance.mInputData[i] = std::upper_bound(cuts.begin(), cuts.end(), value) - cuts.begin();
+    }
+}
+
+void quantile_discretizer::refit() {
+    vector<double> sorted;
+    for (int i = 0; i < samples.size(); i++) {
+        sorted = samples[i];
+        std::sort(sorted.begin(), sorted.end());
+        vector<double>& cuts = cut_points[i];
+        cuts.clear();
+        if (sorted.empty()) {
+            continue;
+        }
+
+        vector<double> distinct = sorted;
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        if (distinct.size() <= num_bins) {
+            for (int j = 1; j < distinct.size(); j++) {
+                cuts.push_back(distinct[j]);
+            }
+            continue;
+        }
+
+        for (int bin = 1; bin < num_bins; bin++) {
+            double cut = sorted[(size_t) bin * sorted.size() / num_bins];
+            // ties at a quantile collapse into a single cut
+            if (cuts.empty() || cut > cuts.back()) {
+                cuts.push_back(cut);
+            }
+        }
+    }
+}
+
+int quantile_discretizer::get_num_bins() const {
+    return num_bins;
+}
+
+bool quantile_discretizer::is_frozen() const {
+    return frozen;
+}
+
+long quantile_discretizer::get_memory_bytes() const {
+    long bytes = sizeof(quantile_discretizer)
+                 + (samples.capacity() + cut_points.capacity()) * sizeof(vector<double>);
+    for (auto& sample : samples) {
+        bytes += sample.capacity() * sizeof(double);
+    }
+    for (auto& cuts : cut_points) {
+        bytes += cuts.capacity() * sizeof(double);
+    }
+    return bytes;
+}
@@ -0,0 +1,51 @@
+#ifndef QUANTILE_DISCRETIZER_H
+#define QUANTILE_DISCRETIZER_H
+
+#include <streamDM/streams/ArffReader.h>
+
+// Replaces a stream's attribute values by bin indices 0 .. num_bins-1 as
+// instances are read, so trees and instance stores downstream see small
+// integers (stored as one byte per value).
+// Bins are equal-frequency ranges of each attribute, fit once on the first
+// warmup_instances instances and then frozen. The reader holds those
+// instances back until the cut points are frozen, so every instance, the
+// first ones included, is binned by the same cut points. Attributes with at
+// most num_bins distinct values get one bin per value. Missing values are
+// left in place.
+// Learners that transfer trees share one discretizer, so a bin index means
+// the same range in all of them; it is fit by the first learner that reads
+// and only read once frozen.
+class quantile_discretizer {
+public:
+    quantile_discretizer(int num_bins, int warmup_instances);
+
+    // adds the instance's values to the sample, the cut points are frozen
+    // once it holds warmup_instances
+    void observe(Instance& instance);
+    // fits the cut points on the sample so far, for streams shorter than
+    // warmup_instances
+    void freeze();
+    // the cut points must be frozen
+    void discretize(DenseInstance& instance);
+
+    int get_num_bins() const;
+    bool is_frozen() const;
+    long get_memory_bytes() const;
+
+private:
+    int num_bins;
+    int warmup_instances;
+    long num_seen = 0;
+    bool frozen = false;
+
+    // per attribute, raw values until the cut points are frozen
+    vector<vector<double>> samples;
+    // per attribute, ascending; a value falls into the bin of the number of
+    // cut points at or below it
+    vector<vector<double>> cut_points;
+
+    void init_attributes(int num_attributes);
+    void refit();
+};
+
+#endif //QUANTILE_DISCRETIZER_H
@@ -0,0 +1,89 @@
+#ifndef RCU_SNAPSHOT_H
+#define RCU_SNAPSHOT_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Single-writer, many-reader publication slot.
+// Readers never take a lock: they register in the current epoch, load the
+// published pointer and deregister when the guard goes out of scope.
+// The writer swaps in a new value, advances the epoch and waits until the
+// readers of the previous epoch have drained before destroying the old value.
+template <typename T>
+class rcu_cell {
+public:
+    class read_guard {
+    public:
+        read_guard(const rcu_cell* cell, int parity, const T* value)
+            : cell(cell), parity(parity), value(value) {}
+
+        read_guard(read_guard&& rhs) : cell(rhs.cell), parity(rhs.parity), value(rhs.value) {
+            rhs.cell = nullptr;
+        }
+
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        ~read_guard() {
+            if (cell != nullptr) {
+                cell->readers[parity].fetch_sub(1);
+            }
+        }
+
+        const T* get() const { return value; }
+        const T* operator->() const { return value; }
+        explicit operator bool() const { return value != nullptr; }
+
+    private:
+        const rcu_cell* cell;
+        int parity;
+        const T* value;
+    };
+
+    rcu_cell() : current(nullptr), epoch(0) {
+        readers[0] = 0;
+        readers[1] = 0;
+    }
+
+    ~rcu_cell() {
+        delete current.load();
+    }
+
+    rcu_cell(const rcu_cell&) = delete;
+    rcu_cell& operator=(const rcu_cell&) = delete;
+
+    read_guard read() const {
+        while (true) {
+            unsigned long e = epoch.load();
+            int parity = (int) (e & 1);
+            readers[parity].fetch_add(1);
+            if (epoch.load() == e) {
+                return read_guard(this, parity, current.load());
+            }
+            // raced with a publish, register again in the new epoch
+            readers[parity].fetch_sub(1);
+        }
+    }
+
+    // must only be called from the owning (training) thread
+    void publish(std::unique_ptr<T> value) {
+        T* old_value = current.exchange(value.release());
+        unsigned long old_epoch = epoch.fetch_add(1);
+        while (readers[old_epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+        delete old_value;
+    }
+
+    bool empty() const {
+        return current.load() == nullptr;
+    }
+
+private:
+    std::atomic<T*> current;
+    std::atomic<unsigned long> epoch;
+    mutable std::atomic<int> readers[2];
+};
+
+#endif //RCU_SNAPSHOT_H
@@ -0,0 +1,93 @@
+#include "shared_observation_log.h"
+
+void shared_observation_log::append(const Instance& instance) {
+    // streamDM getters are not const-qualified, nothing is written through this reference
+    Instance& source = const_cast<Instance&>(instance);
+    if (num_attributes < 0) {
+        num_attributes = source.getNumberInputAttributes();
+    }
+
+    drop_unread_rows();
+    for (int i = 0; i < num_attributes; i++) {
+        values.push_back(source.getInputAttributeValue(i));
+    }
+    labels.push_back(source.getLabel());
+    last_instance = &instance;
+    end_row++;
+}
+
+const Instance* shared_observation_log::get_last_instance() const {
+    return last_instance;
+}
+
+long shared_observation_log::get_end_row() const {
+    return end_row;
+}
+
+const double* shared_observation_log::get_values(long row) const {
+    return values.data() + (row - begin_row) * num_attributes;
+}
+
+int shared_observation_log::get_label(long row) const {
+    return labels[row - begin_row];
+}
+
+int shared_observation_log::get_num_attributes() const {
+    return num_attributes;
+}
+
+void shared_observation_log::attach(long first_row) {
+    std::lock_guard<std::mutex> lock(attached_mutex);
+    attached_rows[first_row]++;
+    num_attached++;
+}
+
+void shared_observation_log::detach(long first_row) {
+    std::lock_guard<std::mutex> lock(attached_mutex);
+    auto it = attached_rows.find(first_row);
+    if (it == attached_rows.end()) {
+        cout << "shared_observation_log: no member attached at row " << first_row << endl;
+        exit(1);
+    }
+    if (--it->second == 0) {
+        attached_rows.erase(it);
+    }
+    num_attached--;
+}
+
+int shared_observation_log::get_num_attached() const {
+    return num_attached;
+}
+
+long shared_observation_log::get_row_bytes() const {
+    return std::max(num_attributes, 0) * sizeof(double) + sizeof(int);
+}
+
+long shared_observation_log::get_memory_bytes() const {
+    return sizeof(shared_observation_log)
+           + values.capacity() * sizeof(double)
+           + labels.capacity() * sizeof(int)
+           + attached_rows.size() * (sizeof(long) + sizeof(int) + 4 * sizeof(void*));
+}
+
+// rows are erased once the unread ones make up half of the log, so each row
+// is moved at most once on average and the log shrinks with its readers
+void shared_observation_log::drop_unread_rows() {
+    long oldest_read_row;
+    {
+        std::lock_guard<std::mutex> lock(attached_mutex);
+        oldest_read_row = attached_rows.empty() ? end_row : attached_rows.begin()->first;
+    }
+
+    long num_unread = oldest_read_row - begin_row;
+    if (num_unread == 0 || 2 * num_unread < end_row - begin_row) {
+        return;
+    }
+    values.erase(values.begin(), values.begin() + num_unread * num_attributes);
+    labels.erase(labels.begin(), labels.begin() + num_unread);
+    begin_row = oldest_read_row;
+    if (values.capacity() > 2 * values.size()) {
+        values.shrink_to_fit();
+        labels.shrink_to_fit();
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef SHARED_OBSERVATION_LOG_H
+#define SHARED_OBSERVATION_LOG_H
+
+#include <atomic>
+#include <mutex>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Attribute values and labels of the instances a tree pool trains on,
+// recorded once for every member whose root has not split yet. Members keep
+// only their weight of each row and rebuild their root's observers from the
+// log when they attempt a split.
+// Rows are numbered from the pool's first instance on; rows older than the
+// oldest attached member are dropped. Members may detach from any thread
+// (discarded trees are destroyed on the reclaimer's), appending and reading
+// belong to the training thread.
+class shared_observation_log {
+public:
+    // the newest row
+    void append(const Instance& instance);
+    // the instance the newest row was recorded from, to tell whether a
+    // member is trained on it
+    const Instance* get_last_instance() const;
+    long get_end_row() const;
+
+    const double* get_values(long row) const;
+    int get_label(long row) const;
+    int get_num_attributes() const;
+
+    // a member reads the rows from first_row on until it detaches
+    void attach(long first_row);
+    void detach(long first_row);
+    int get_num_attached() const;
+
+    long get_row_bytes() const;
+    long get_memory_bytes() const;
+
+private:
+    int num_attributes = -1;
+    long begin_row = 0;
+    long end_row = 0;
+    // row-major from begin_row
+    vector<double> values;
+    vector<int> labels;
+    const Instance* last_instance = nullptr;
+
+    mutable std::mutex attached_mutex;
+    // first row of the attached members, with their count
+    std::map<long, int> attached_rows;
+    std::atomic<int> num_attached{0};
+
+    void drop_unread_rows();
+};
+
+#endif //SHARED_OBSERVATION_LOG_H
@@ -0,0 +1,157 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "spill_file.h"
+
+// never destroyed, extents may be released during static destruction
+spill_file& spill_file::get_process_spill_file() {
+    static spill_file* file = new spill_file();
+    return *file;
+}
+
+// file_mutex must be held
+void spill_file::open_file() {
+    const char* tmp_dir = getenv("TMPDIR");
+    string path = string(tmp_dir != nullptr && tmp_dir[0] != '\0' ? tmp_dir : "/tmp")
+                  + "/trans_tree_spill_XXXXXX";
+
+    vector<char> path_buffer(path.begin(), path.end());
+    path_buffer.push_back('\0');
+    fd = mkstemp(path_buffer.data());
+    if (fd < 0) {
+        cout << "spill_file: cannot create " << path << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+    unlink(path_buffer.data());
+}
+
+shared_ptr<spill_file::extent> spill_file::append(const string& bytes) {
+    std::lock_guard<std::mutex> lock(file_mutex);
+
+    if (fd < 0) {
+        open_file();
+    }
+
+    long offset = end_offset;
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t count = pwrite(fd, bytes.data() + written, bytes.size() - written, offset + written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            cout << "spill_file: write failed: " << strerror(errno) << endl;
+            exit(1);
+        }
+        written += count;
+    }
+
+    end_offset += bytes.size();
+    spilled_bytes += bytes.size();
+    spill_count++;
+
+    return make_shared<extent>(*this, offset, bytes.size());
+}
+
+// pread does not move the file offset, readers need no lock
+void spill_file::read_at(long offset, long length, string& bytes) {
+    posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+
+    bytes.resize(length);
+    long done = 0;
+    while (done < length) {
+        ssize_t count = pread(fd, &bytes[done], length - done, offset + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            cout << "spill_file: read failed: " << strerror(errno) << endl;
+            exit(1);
+        }
+        done += count;
+    }
+}
+
+void spill_file::release(long offset, long length) {
+    std::lock_guard<std::mutex> lock(file_mutex);
+
+    spilled_bytes -= length;
+    if (spilled_bytes == 0) {
+        // nothing is referenced anymore, start over; appends overwrite the
+        // old contents even if the truncation failed
+        end_offset = 0;
+        if (ftruncate(fd, 0) != 0) {
+            report_release_failure("ftruncate", 0);
+            return;
+        }
+        unreleased_bytes = 0;
+        return;
+    }
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (can_punch_holes) {
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0) {
+            return;
+        }
+        // the file system cannot punch holes, later releases wait for the truncation
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            can_punch_holes = false;
+        }
+        report_release_failure("fallocate", length);
+        return;
+    }
+#endif
+    unreleased_bytes += length;
+}
+
+void spill_file::report_release_failure(const char* call, long length) {
+    if (release_failure_count == 0) {
+        cout << "spill_file: " << call << " failed: " << strerror(errno) << endl;
+    }
+    release_failure_count++;
+    unreleased_bytes += length;
+}
+
+long spill_file::get_spilled_bytes() const {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    return spilled_bytes;
+}
+
+long spill_file::get_spill_count() const {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    return spill_count;
+}
+
+long spill_file::get_release_failure_count() const {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    return release_failure_count;
+}
+
+long spill_file::get_unreleased_bytes() const {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    return unreleased_bytes;
+}
+
+// class extent
+spill_file::extent::extent(spill_file& file, long offset, long length) :
+        file(file),
+        offset(offset),
+        length(length) {}
+
+spill_file::extent::~extent() {
+    file.release(offset, length);
+}
+
+string spill_file::extent::read() const {
+    string bytes;
+    file.read_at(offset, length, bytes);
+    return bytes;
+}
+
+long spill_file::extent::get_length() const {
+    return length;
+}
@@ -0,0 +1,61 @@
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include <mutex>
+
+#include <streamDM/streams/ArffReader.h>
+
+// Process-wide scratch file for cold data evicted from memory.
+// The file is created in $TMPDIR (or /tmp) on first use and unlinked right
+// away, so it disappears with the process. Writes are serialized, reads use
+// pread and run concurrently. Data is appended and handed back
+// as an extent; the extent's space is released (hole punched) when the last
+// reference to it goes away. Failed releases are reported once and counted,
+// their space comes back when the file is truncated after the last extent.
+class spill_file {
+public:
+    class extent {
+    public:
+        extent(spill_file& file, long offset, long length);
+        ~extent();
+
+        // one sequential read, preceded by a readahead hint
+        string read() const;
+        long get_length() const;
+
+    private:
+        spill_file& file;
+        long offset;
+        long length;
+    };
+
+    static spill_file& get_process_spill_file();
+
+    shared_ptr<extent> append(const string& bytes);
+
+    long get_spilled_bytes() const;
+    long get_spill_count() const;
+    // released extents whose space stays allocated until the file is truncated
+    long get_release_failure_count() const;
+    long get_unreleased_bytes() const;
+
+private:
+    spill_file() = default;
+
+    mutable std::mutex file_mutex;
+    int fd = -1;
+    long end_offset = 0;
+    long spilled_bytes = 0;
+    long spill_count = 0;
+    bool can_punch_holes = true;
+    long release_failure_count = 0;
+    long unreleased_bytes = 0;
+
+    void open_file();
+    void read_at(long offset, long length, string& bytes);
+    void release(long offset, long length);
+    // file_mutex must be held
+    void report_release_failure(const char* call, long length);
+};
+
+#endif //SPILL_FILE_H
@@ -0,0 +1,98 @@
+#include "split_scheduler.h"
+
+// class split_task
+split_task::split_task(std::function<void()> work) :
+        work(std::move(work)),
+        claimed(false) {}
+
+bool split_task::claim() {
+    return !claimed.exchange(true);
+}
+
+void split_task::run() {
+    work();
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        done = true;
+    }
+    done_signal.notify_all();
+}
+
+void split_task::wait() {
+    if (claim()) {
+        run();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_signal.wait(lock, [this] { return done; });
+}
+
+// class split_scheduler
+split_scheduler::split_scheduler(int num_workers) :
+        submitted_count(0),
+        worker_count(0) {
+
+    if (num_workers < 1) {
+        cout << "split_scheduler: num_workers must be positive" << endl;
+        exit(1);
+    }
+    for (int i = 0; i < num_workers; i++) {
+        workers.emplace_back(&split_scheduler::run, this);
+    }
+}
+
+split_scheduler::~split_scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+shared_ptr<split_task> split_scheduler::submit(std::function<void()> work) {
+    shared_ptr<split_task> task = make_shared<split_task>(std::move(work));
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.push_back(task);
+    }
+    submitted_count++;
+    work_available.notify_one();
+    return task;
+}
+
+int split_scheduler::get_num_workers() const {
+    return workers.size();
+}
+
+long split_scheduler::get_submitted_count() const {
+    return submitted_count;
+}
+
+long split_scheduler::get_inline_count() const {
+    return submitted_count - worker_count;
+}
+
+// tasks already run inline stay in the queue until a worker drops them
+void split_scheduler::run() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+        work_available.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+
+        shared_ptr<split_task> task = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        if (task->claim()) {
+            task->run();
+            worker_count++;
+        }
+        task = nullptr;
+        lock.lock();
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SPLIT_SCHEDULER_H
+#define SPLIT_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <streamDM/streams/ArffReader.h>
+
+// One queued split evaluation. It runs once, on a worker or on the first
+// thread that waits for it before any worker has picked it up.
+class split_task {
+public:
+    explicit split_task(std::function<void()> work);
+
+    // true if this call gets to run the work
+    bool claim();
+    void run();
+    // returns once the work has run, running it here if it is still queued
+    void wait();
+
+private:
+    std::function<void()> work;
+    std::atomic<bool> claimed;
+    bool done = false;
+    std::mutex done_mutex;
+    std::condition_variable done_signal;
+};
+
+// Worker threads evaluating split attempts of compact trees off the
+// training thread. Evaluations only read a leaf; the tree applies the
+// result itself before it is trained again, so a burst of attempts, e.g.
+// all pool members reaching their grace period on the same instance,
+// spreads over the workers while the training thread moves on.
+class split_scheduler {
+public:
+    explicit split_scheduler(int num_workers);
+    // runs the tasks still queued, then joins the workers
+    ~split_scheduler();
+
+    shared_ptr<split_task> submit(std::function<void()> work);
+
+    int get_num_workers() const;
+    long get_submitted_count() const;
+    // tasks that were waited for before a worker picked them up
+    long get_inline_count() const;
+
+private:
+    std::mutex queue_mutex;
+    std::condition_variable work_available;
+    std::deque<shared_ptr<split_task>> queue;
+    bool stopping = false;
+    vector<std::thread> workers;
+
+    std::atomic<long> submitted_count;
+    std::atomic<long> worker_count;
+
+    void run();
+};
+
+#endif //SPLIT_SCHEDULER_H
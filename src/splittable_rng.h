@@ -0,0 +1,63 @@
+#ifndef SPLITTABLE_RNG_H
+#define SPLITTABLE_RNG_H
+
+#include <cstdint>
+
+// xoshiro256** generator with 32 bytes of state, seeded through splitmix64.
+// Meets the UniformRandomBitGenerator requirements, so it plugs into the
+// standard distributions in place of std::mt19937 (about 5 KB of state).
+// split() derives an independent child stream from the next output of this
+// one: the same seed and the same sequence of splits always give the same
+// children, whichever thread consumes them later.
+class splittable_rng {
+public:
+    typedef uint64_t result_type;
+
+    explicit splittable_rng(uint64_t seed = 0) {
+        for (int i = 0; i < 4; i++) {
+            state[i] = splitmix64(seed);
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    result_type operator()() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+
+        return result;
+    }
+
+    splittable_rng split() {
+        return splittable_rng((*this)());
+    }
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif //SPLITTABLE_RNG_H
@@ -0,0 +1,164 @@
+#include "training_queue.h"
+
+training_queue::training_queue(int capacity,
+                               string overflow_policy_str,
+                               std::function<void(shared_ptr<Instance>)> train_fn) :
+        ring(capacity),
+        train_fn(train_fn),
+        stopping(false),
+        enqueued_count(0),
+        trained_count(0),
+        dropped_count(0),
+        subsampled_count(0),
+        max_lag(0),
+        consumer_waiting(false),
+        num_blocked_producers(0),
+        num_flush_waiters(0) {
+
+    if (overflow_policy_map.find(overflow_policy_str) == overflow_policy_map.end()) {
+        cout << "Invalid overflow policy: " << overflow_policy_str << endl;
+        exit(1);
+    }
+    this->overflow_policy = overflow_policy_map[overflow_policy_str];
+
+    worker = std::thread(&training_queue::run, this);
+}
+
+training_queue::~training_queue() {
+    stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+    }
+    work_available.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool training_queue::enqueue(shared_ptr<Instance> instance) {
+    if (overflow_policy == overflow_policy_enum::subsample_policy && !admit_subsample()) {
+        subsampled_count++;
+        return false;
+    }
+
+    if (!ring.try_push(instance)) {
+        if (overflow_policy != overflow_policy_enum::block_policy) {
+            dropped_count++;
+            return false;
+        }
+
+        num_blocked_producers++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        space_available.wait(lock, [this, &instance] { return ring.try_push(instance); });
+        lock.unlock();
+        num_blocked_producers--;
+    }
+
+    enqueued_count++;
+    update_max_lag();
+    notify_if_waiting(consumer_waiting, work_available);
+    return true;
+}
+
+bool training_queue::admit_subsample() {
+    static thread_local std::minstd_rand subsample_rand(std::random_device{}());
+
+    double capacity = ring.get_capacity();
+    double depth = ring.size();
+    double high_watermark = capacity / 2;
+    if (depth <= high_watermark) {
+        return true;
+    }
+
+    double admit_prob = (capacity - depth) / (capacity - high_watermark);
+    std::uniform_real_distribution<double> uniform_distr(0.0, 1.0);
+    return uniform_distr(subsample_rand) < admit_prob;
+}
+
+void training_queue::update_max_lag() {
+    long lag = get_lag();
+    long cur_max_lag = max_lag.load();
+    while (lag > cur_max_lag && !max_lag.compare_exchange_weak(cur_max_lag, lag)) {}
+}
+
+void training_queue::flush() {
+    num_flush_waiters++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        drained.wait(lock, [this] { return get_lag() == 0; });
+    }
+    num_flush_waiters--;
+}
+
+// the seq_cst fence orders the caller's update before the load of the flag,
+// the waiter sets the flag before checking the update, so one of them sees
+// the other's write; taking the lock makes sure a waiter seen is waiting
+void training_queue::notify_if_waiting(const std::atomic<bool>& waiting, std::condition_variable& signal) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        signal.notify_all();
+    }
+}
+
+void training_queue::notify_if_waiting(const std::atomic<int>& num_waiting, std::condition_variable& signal) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_waiting.load() > 0) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        signal.notify_all();
+    }
+}
+
+void training_queue::run() {
+    shared_ptr<Instance> instance;
+
+    while (true) {
+        if (ring.try_pop(instance)) {
+            notify_if_waiting(num_blocked_producers, space_available);
+            train_fn(instance);
+            instance = nullptr;
+            trained_count++;
+            notify_if_waiting(num_flush_waiters, drained);
+            continue;
+        }
+
+        if (stopping.load()) {
+            break;
+        }
+
+        consumer_waiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        work_available.wait(lock, [this] { return stopping.load() || ring.size() > 0; });
+        lock.unlock();
+        consumer_waiting = false;
+    }
+}
+
+long training_queue::get_lag() const {
+    // the counters are updated independently, a fast consumer may briefly overtake
+    long lag = enqueued_count.load() - trained_count.load();
+    return lag > 0 ? lag : 0;
+}
+
+long training_queue::get_max_lag() const {
+    return max_lag.load();
+}
+
+long training_queue::get_enqueued_count() const {
+    return enqueued_count.load();
+}
+
+long training_queue::get_trained_count() const {
+    return trained_count.load();
+}
+
+long training_queue::get_dropped_count() const {
+    return dropped_count.load();
+}
+
+long training_queue::get_subsampled_count() const {
+    return subsampled_count.load();
+}
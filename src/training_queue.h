@@ -0,0 +1,84 @@
+#ifndef TRAINING_QUEUE_H
+#define TRAINING_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <streamDM/streams/ArffReader.h>
+
+#include "mpsc_ring.h"
+
+enum class overflow_policy_enum { block_policy, drop_policy, subsample_policy };
+
+// Decouples prediction from training.
+// Labelled instances are pushed into a bounded lock-free ring and a dedicated
+// thread, which owns the learner, trains on them in arrival order.
+// When the ring fills up the overflow policy decides what happens:
+//   block:     the producer waits for a free slot
+//   drop:      the instance is discarded
+//   subsample: above half capacity instances are admitted with a probability
+//              that falls linearly to zero as the ring fills
+// Pushes and pops stay lock-free; the consumer parks on a condition variable
+// while the ring is empty, as do blocked producers and flush. A side takes
+// the lock to wake the other only when it has announced that it is waiting.
+class training_queue {
+public:
+    training_queue(int capacity,
+                   string overflow_policy_str,
+                   std::function<void(shared_ptr<Instance>)> train_fn);
+    ~training_queue();
+
+    // returns false if the instance was shed by the overflow policy
+    bool enqueue(shared_ptr<Instance> instance);
+
+    // blocks until every admitted instance has been trained
+    void flush();
+
+    long get_lag() const;
+    long get_max_lag() const;
+    long get_enqueued_count() const;
+    long get_trained_count() const;
+    long get_dropped_count() const;
+    long get_subsampled_count() const;
+
+private:
+    std::map<string, overflow_policy_enum> overflow_policy_map =
+            {
+                    { "block", overflow_policy_enum::block_policy },
+                    { "drop", overflow_policy_enum::drop_policy },
+                    { "subsample", overflow_policy_enum::subsample_policy },
+            };
+    overflow_policy_enum overflow_policy = overflow_policy_enum::block_policy;
+
+    mpsc_ring<shared_ptr<Instance>> ring;
+    std::function<void(shared_ptr<Instance>)> train_fn;
+    std::thread worker;
+    std::atomic<bool> stopping;
+
+    std::atomic<long> enqueued_count;
+    std::atomic<long> trained_count;
+    std::atomic<long> dropped_count;
+    std::atomic<long> subsampled_count;
+    std::atomic<long> max_lag;
+
+    std::mutex wait_mutex;
+    std::condition_variable work_available;
+    std::condition_variable space_available;
+    std::condition_variable drained;
+    std::atomic<bool> consumer_waiting;
+    std::atomic<int> num_blocked_producers;
+    std::atomic<int> num_flush_waiters;
+
+    bool admit_subsample();
+    void update_max_lag();
+    // wakes the waiters on signal if waiting is set, after the caller's
+    // update of the ring or the counters
+    void notify_if_waiting(const std::atomic<bool>& waiting, std::condition_variable& signal);
+    void notify_if_waiting(const std::atomic<int>& num_waiting, std::condition_variable& signal);
+    void run();
+};
+
+#endif //TRAINING_QUEUE_H
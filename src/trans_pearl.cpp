@@ -47,6 +47,8 @@ trans_pearl::trans_pearl(int num_trees,
         eviction_interval(eviction_interval),
         transfer_kappa_threshold(transfer_kappa_threshold) {
 
+    pool_rand = splittable_rng(seed);
+
     if (boost_mode_map.find(boost_mode_str) == boost_mode_map.end() ) {
         cout << "Invalid boost mode" << endl;
         exit(1);
@@ -69,15 +71,21 @@ void trans_pearl::init() {
     for (auto t : temp_tree_pool) {
         tree_pool.push_back(t);
     }
+
+    if (snapshot_refresh.is_enabled()) {
+        publish_snapshot();
+    }
 }
 
 shared_ptr<pearl_tree> trans_pearl::make_pearl_tree(int tree_pool_id) {
-    return make_shared<trans_pearl_tree>(tree_pool_id,
-                                         kappa_window_size,
-                                         warning_delta,
-                                         drift_delta,
-                                         mrand,
-                                         instance_store_size);
+    shared_ptr<trans_pearl_tree> tree = make_shared<trans_pearl_tree>(tree_pool_id,
+                                                                      kappa_window_size,
+                                                                      warning_delta,
+                                                                      drift_delta,
+                                                                      mrand,
+                                                                      instance_store_size);
+    tree->set_neighbour_search(neighbour_search, neighbour_search_trees, neighbour_search_leaf_size);
+    return tree;
 }
 
 // foreground trees make predictions, update votes, keep track of actual labels
@@ -100,6 +108,8 @@ void trans_pearl::train() {
         init();
     }
 
+    load_shedding.begin_instance();
+
     potential_drifted_tree_indices.clear();
 
     num_instances_seen++;
@@ -116,6 +126,8 @@ void trans_pearl::train() {
     vector<int> drifted_tree_pos_list;
 
     shared_ptr<trans_pearl_tree> cur_tree = nullptr;
+    // the instance is appended to the log once, by the first tree storing it
+    long log_row = -1;
 
     for (int i = 0; i < num_trees; i++) {
         if (drift_warning_period_lengths[i] > 0) {
@@ -123,7 +135,12 @@ void trans_pearl::train() {
         }
 
         cur_tree = static_pointer_cast<trans_pearl_tree>(foreground_trees[i]);
-        cur_tree->store_instance(instance);
+        if (cur_tree->is_storing()) {
+            if (log_row < 0) {
+                log_row = retained_log.append(*instance);
+            }
+            cur_tree->store_instance(retained_log, log_row);
+        }
         transfer(i, instance);
 
         // online bagging
@@ -134,8 +151,12 @@ void trans_pearl::train() {
             continue;
         }
 
-        instance->setWeight(weight);
-        cur_tree->train(*instance);
+        if (load_shedding.skip_foreground()) {
+            continue;
+        }
+
+        bool train_bg_tree = cur_tree->bg_pearl_tree == nullptr || !load_shedding.skip_background();
+        cur_tree->train(*instance, weight, train_bg_tree);
 
         // if (cur_tree->instance_store.size() > 2000) {
         //     for (int idx = 0; idx < num_trees; idx++) {
@@ -208,7 +229,8 @@ void trans_pearl::train() {
                         eviction_interval,
                         transfer_kappa_threshold,
                         tree_template,
-                        this->lambda);
+                        this->lambda,
+                        pool_rand.split());
             }
         }
 
@@ -243,6 +265,12 @@ void trans_pearl::train() {
 
         adapt_state(drifted_tree_pos_list, candidate_trees);
     }
+
+    if (snapshot_refresh.on_train()) {
+        publish_snapshot();
+    }
+
+    load_shedding.end_instance();
 }
 
 void trans_pearl::select_predicted_trees(const vector<int>& warning_tree_pos_list) {
@@ -416,6 +444,68 @@ int trans_pearl::get_transferred_tree_group_size() const {
     return this->transferred_tree_total_count;
 }
 
+void trans_pearl::set_snapshot_staleness(int max_instances, int max_millis) {
+    snapshot_refresh.set_staleness(max_instances, max_millis);
+    if (!foreground_trees.empty()) {
+        publish_snapshot();
+    }
+}
+
+// must be called from the thread that trains this learner
+void trans_pearl::publish_snapshot() {
+    unique_ptr<model_snapshot> next_snapshot = make_unique<model_snapshot>(num_instances_seen);
+    for (auto& foreground_tree : foreground_trees) {
+        next_snapshot->add_tree(*foreground_tree->tree);
+    }
+    snapshot.publish(std::move(next_snapshot));
+    snapshot_refresh.on_publish();
+}
+
+int trans_pearl::predict_snapshot() {
+    return predict_snapshot(*instance);
+}
+
+// safe to call from any thread while another thread trains
+int trans_pearl::predict_snapshot(Instance& instance) {
+    auto cur_snapshot = snapshot.read();
+    if (!cur_snapshot) {
+        // nothing published yet
+        return 0;
+    }
+
+    return cur_snapshot->predict(instance);
+}
+
+void trans_pearl::set_instance_store_encoding(string encoding_str) {
+    retained_log.set_encoding(parse_value_encoding(encoding_str));
+}
+
+void trans_pearl::set_neighbour_search(string search_str, int num_trees, int leaf_size) {
+    neighbour_search = parse_neighbour_search(search_str);
+    if (neighbour_search == neighbour_search_enum::rp_forest_search && (num_trees < 1 || leaf_size < 1)) {
+        cout << "set_neighbour_search: num_trees and leaf_size must be positive" << endl;
+        exit(1);
+    }
+    neighbour_search_trees = num_trees;
+    neighbour_search_leaf_size = leaf_size;
+
+    // trees created before the call
+    for (auto& tree : tree_pool) {
+        static_pointer_cast<trans_pearl_tree>(tree)->set_neighbour_search(neighbour_search,
+                                                                          num_trees,
+                                                                          leaf_size);
+    }
+}
+
+void trans_pearl::set_load_shedding(double target_rate) {
+    load_shedding.set_target_rate(target_rate);
+}
+
+// level, shed replays, shed perf_evals, shed background updates, shed foreground updates
+vector<long> trans_pearl::get_load_shedding_stats() {
+    return load_shedding.get_stats();
+}
+
 void trans_pearl::set_expected_drift_prob(int tree_idx, double p) {
     shared_ptr<pearl_tree> cur_tree = nullptr;
     cur_tree = static_pointer_cast<pearl_tree>(foreground_trees[tree_idx]);
@@ -467,6 +557,7 @@ bool trans_pearl::transfer(int i, Instance* instance) {
         return false;
     }
 
+    bbt_pools[i]->enable_perf_eval = !load_shedding.skip_perf_eval();
     bbt_pools[i]->online_boost(instance, true);
 
     if (bbt_pools[i]->matched_tree == nullptr) {
@@ -477,10 +568,12 @@ bool trans_pearl::transfer(int i, Instance* instance) {
     }
 
     // After actual drift point, perform boosting with weight decrement
-    for (int j = 0; j < num_diff_distr_instances; j++) {
-        Instance* transfer_instance = bbt_pools[i]->get_next_diff_distr_instance();
-        if (transfer_instance != nullptr) {
-            bbt_pools[i]->online_boost(transfer_instance, false);
+    if (!load_shedding.skip_replay()) {
+        for (int j = 0; j < num_diff_distr_instances; j++) {
+            Instance* transfer_instance = bbt_pools[i]->get_next_diff_distr_instance();
+            if (transfer_instance != nullptr) {
+                bbt_pools[i]->online_boost(transfer_instance, false);
+            }
         }
     }
 
@@ -643,17 +736,22 @@ trans_pearl_tree::trans_pearl_tree(trans_pearl_tree &rhs)
                      rhs.warning_delta,
                      rhs.drift_delta,
                      rhs.mrand),
-          instance_store_size(instance_store_size) {}
-          // TODO
+          instance_store_size(rhs.instance_store_size),
+          knn_indices(rhs.knn_indices) {
+    // TODO
+}
 
-void trans_pearl_tree::store_instance(Instance* instance) {
-    if (instance == nullptr) {
-        cout << "nullptr instance added! " << endl;
-        exit(1);
+bool trans_pearl_tree::is_storing() const {
+    if (instance_store.size() < instance_store_size) {
+        return true;
     }
+    return bg_pearl_tree != nullptr
+           && static_pointer_cast<trans_pearl_tree>(bg_pearl_tree)->instance_store.size() < instance_store_size;
+}
 
+void trans_pearl_tree::store_instance(instance_log& log, long row) {
     if (this->instance_store.size() < this->instance_store_size) {
-        this->instance_store.push_back(instance);
+        this->instance_store.append(log, row);
         // this->instance_store.pop_front();
     }
 
@@ -662,131 +760,115 @@ void trans_pearl_tree::store_instance(Instance* instance) {
         trans_bg_tree = static_pointer_cast<trans_pearl_tree>(this->bg_pearl_tree);
 
         if (trans_bg_tree->instance_store.size() < this->instance_store_size) {
-            trans_bg_tree->instance_store.push_back(instance);
+            trans_bg_tree->instance_store.append(log, row);
             // trans_bg_tree->instance_store.pop_front();
         }
     }
 }
 
-vector<Instance*> trans_pearl_tree::generate_data(Instance* instance, int num_instances) {
-    if (this->instance_store.size() < 10) {
-        cout << "generate_data: not enough warning period data " << this->instance_store.size() << endl;
-        return vector<Instance*>();
+// mirrors pearl_tree::train without writing the weight into the shared instance
+void trans_pearl_tree::train(const Instance& instance, double weight, bool train_bg_tree) {
+    train_weighted(*tree, instance, weight);
+
+    if (bg_pearl_tree != nullptr && train_bg_tree) {
+        train_weighted(*bg_pearl_tree->tree, instance, weight);
     }
+}
 
-    // cout << "generate_data..." << this->instance_store.size() << endl;
+vector<Instance*> trans_pearl_tree::generate_data(Instance* instance, int num_instances) {
     vector<Instance*> pseudo_instances;
+    if (!generate_batch(instance, num_instances, pseudo_batch)) {
+        return pseudo_instances;
+    }
 
-    // for (int i = 0; i < this->instance_store.size(); i++) {
-    //     if (this->instance_store[i] == nullptr) {
-    //         cout << "generate_data: instance in instance_store is null" << endl;
-    //         cout << "generate_data: index " << i << endl;
-    //         cout << "generate_data: instance_store size: " << this->instance_store.size() << endl;
-    //         exit(1);
-    //     }
-    //     pseudo_instances.push_back(this->instance_store[i]);
-    // }
-
-    for (int i = 0; i < num_instances; i++) {
-        DenseInstance *pseudo_instance = this->tree->generate_data((DenseInstance *) instance);
-        vector<DenseInstance*> close_instances = this->find_k_closest_instances(pseudo_instance,
-                                                                          this->instance_store,
-                                                                          1);
-
-        // cout << "Before KNN-----------------------------" << endl;
-        // for (double v : pseudo_instance->mInputData) {
-        //     cout << v << " ";
-        // }
-        // for (double v : pseudo_instance->mOutputData) {
-        //     cout << v << " ";
-        // }
-        // cout << endl;
-
-        // Copy the rest of the attribute values to the pseudo instance
-        for (Instance *close_instance : close_instances) {
-            vector<int> modified_indices = pseudo_instance->modifiedAttIndices;
-            for (int j = 0; j < close_instance->getNumberInputAttributes(); j++) {
-                if (std::find(modified_indices.begin(), modified_indices.end(), j) != modified_indices.end()) {
-                    continue;
-                }
-                pseudo_instance->setValue(j, close_instance->getInputAttributeValue(j));
-            }
-        }
+    for (int i = 0; i < pseudo_batch.size(); i++) {
+        DenseInstance* pseudo_instance = new DenseInstance();
+        pseudo_batch.materialize(i, *pseudo_instance, instance->getInstanceInformation());
         pseudo_instances.push_back(pseudo_instance);
-
-        // cout << "After KNN-----------------------------" << endl;
-        // for (double v : pseudo_instance->mInputData) {
-        //     cout << v << " ";
-        // }
-        // for (double v : pseudo_instance->mOutputData) {
-        //     cout << v << " ";
-        // }
-        // cout << endl;
     }
 
     return pseudo_instances;
 }
 
-vector<DenseInstance*> trans_pearl_tree::find_k_closest_instances(DenseInstance* target_instance,
-                                                             deque<Instance*>& instance_store,
-                                                             int k) {
-    int num_row = target_instance->modifiedAttIndices.size() + 1;
-    int num_col = this->instance_store.size();
-
-    // Prepare data points
-    vector<vector<double>> data(num_row, vector<double>());
-    for (auto cur_instance : this->instance_store) {
-        if (cur_instance == nullptr) {
-            cout << "find_k: instance in instance_store is null" << endl;
-            cout << "find_k: instance_store size: " << this->instance_store.size() << endl;
-            exit(1);
-        }
-        for (int i = 0; i < num_row - 1; i++) {
-            int attIdx = target_instance->modifiedAttIndices[i];
-            data[i].push_back(cur_instance->getInputAttributeValue(attIdx));
-        }
-        data[num_row - 1].push_back(cur_instance->getLabel());
+bool trans_pearl_tree::generate_batch(Instance* instance, int num_instances, pseudo_instance_batch& batch) {
+    if (this->instance_store.size() < 10) {
+        cout << "generate_data: not enough warning period data " << this->instance_store.size() << endl;
+        return false;
     }
 
-    Matrix dataPoints(num_row, num_col);
-    for (int i = 0; i < num_row; i++) {
-        dataPoints.row(i) = Eigen::VectorXd::Map(&data[i][0], data[i].size());
+    int num_attributes = instance->getNumberInputAttributes();
+    batch.reset(num_attributes, num_instances);
+    for (int i = 0; i < num_instances; i++) {
+        // the tree hands out a new instance per call
+        unique_ptr<DenseInstance> generated(this->tree->generate_data((DenseInstance *) instance));
+        batch.append(*generated);
     }
-    // cout << dataPoints << endl;
 
-    knn::KDTreeMinkowski<double, knn::EuclideanDistance<double>> kdtree(dataPoints);
-    kdtree.setBucketSize(16);
-    kdtree.setCompact(false);
-    kdtree.setBalanced(false);
-    kdtree.setTakeRoot(true);
-    kdtree.setMaxDistance(0);
-    kdtree.setThreads(2);
-    kdtree.build();
+    find_closest_instances(batch, close_instance_indices);
 
-    vector<vector<double>> target_data(num_row, vector<double>());
-    for (int i = 0; i < num_row - 1; i++) {
-        int attIdx = target_instance->modifiedAttIndices[i];
-        target_data[i].push_back(target_instance->getInputAttributeValue(attIdx));
+    // Copy the rest of the attribute values from the closest stored instance
+    for (int j = 0; j < num_attributes; j++) {
+        for (int i = 0; i < batch.size(); i++) {
+            if (!batch.is_modified(i, j)) {
+                batch.set_value(i, j, instance_store.get_value(close_instance_indices[i], j));
+            }
+        }
     }
-    target_data[num_row - 1].push_back(target_instance->getLabel());
 
-    Matrix queryPoints(num_row, 1);
-    for (int i = 0; i < num_row; i++) {
-        queryPoints.row(i) = Eigen::VectorXd::Map(&target_data[i][0], target_data[i].size());
-    }
+    return true;
+}
 
-    Matrixi indices;
-    Matrix distances;
-    kdtree.query(queryPoints, k, indices, distances);
+void trans_pearl_tree::find_closest_instances(const pseudo_instance_batch& batch,
+                                              vector<int>& close_instance_indices) {
+    int num_rows = batch.size();
+    close_instance_indices.resize(num_rows);
 
-    vector<DenseInstance*> close_instances;
-    for (int i = 0; i < k; i++) {
-        close_instances.push_back((DenseInstance*) instance_store[indices(i, 0)]);
+    // rows with the same modified attributes are answered by one batched query
+    batch_order.resize(num_rows);
+    for (int i = 0; i < num_rows; i++) {
+        batch_order[i] = i;
     }
+    std::sort(batch_order.begin(), batch_order.end(), [&batch](int lhs, int rhs) {
+        return batch.modified_attributes_less(lhs, rhs);
+    });
+
+    int group_begin = 0;
+    while (group_begin < num_rows) {
+        int first_row = batch_order[group_begin];
+        int group_end = group_begin + 1;
+        while (group_end < num_rows && batch.same_modified_attributes(first_row, batch_order[group_end])) {
+            group_end++;
+        }
+
+        projection.clear();
+        for (int j = 0; j < batch.get_num_attributes(); j++) {
+            if (batch.is_modified(first_row, j)) {
+                projection.push_back(j);
+            }
+        }
+
+        int num_row = projection.size() + 1;
+        query_points.resize(num_row, group_end - group_begin);
+        for (int g = group_begin; g < group_end; g++) {
+            int row = batch_order[g];
+            for (int i = 0; i < num_row - 1; i++) {
+                query_points(i, g - group_begin) = batch.get_value(row, projection[i]);
+            }
+            query_points(num_row - 1, g - group_begin) = batch.get_label(row);
+        }
+
+        knn_indices.query(instance_store, projection, query_points, 1, neighbour_indices);
+        for (int g = group_begin; g < group_end; g++) {
+            close_instance_indices[batch_order[g]] = neighbour_indices(0, g - group_begin);
+        }
 
-    return close_instances;
+        group_begin = group_end;
+    }
 }
 
+void trans_pearl_tree::set_neighbour_search(neighbour_search_enum search, int num_trees, int leaf_size) {
+    knn_indices.set_search(search, num_trees, leaf_size);
+}
 
 // class boosted_bg_tree_pool
 trans_pearl::boosted_bg_tree_pool::boosted_bg_tree_pool(
@@ -795,15 +877,15 @@ trans_pearl::boosted_bg_tree_pool::boosted_bg_tree_pool(
                      int eviction_interval,
                      double transfer_kappa_threshold,
                      shared_ptr<trans_pearl_tree> tree_template,
-                     int lambda):
+                     int lambda,
+                     splittable_rng mrand):
         boost_mode(boost_mode),
         eviction_interval(eviction_interval),
         transfer_kappa_threshold(transfer_kappa_threshold),
         pool_size(pool_size),
         tree_template(tree_template),
-        lambda(lambda) {
-
-    mrand = std::mt19937(42);
+        lambda(lambda),
+        mrand(mrand) {
     oob_tree_lam_sum.resize(pool_size, 0);
     oob_tree_correct_lam_sum.resize(pool_size, 0);
     oob_tree_wrong_lam_sum.resize(pool_size, 0);
@@ -854,7 +936,7 @@ void trans_pearl::boosted_bg_tree_pool::online_boost(Instance *instance,
             exit(1);
     }
 
-    if (is_same_distribution) {
+    if (is_same_distribution && enable_perf_eval) {
         this->perf_eval(instance);
     }
 }
@@ -863,7 +945,8 @@ Instance* trans_pearl::boosted_bg_tree_pool::get_next_diff_distr_instance() {
     if (instance_store_idx >= matched_tree->instance_store.size()) {
         return nullptr;
     }
-    return matched_tree->instance_store[instance_store_idx++];
+    matched_tree->instance_store.materialize(instance_store_idx++, replay_instance);
+    return &replay_instance;
 }
 
 void trans_pearl::boosted_bg_tree_pool::perf_eval(Instance* instance) {
@@ -915,18 +998,13 @@ void trans_pearl::boosted_bg_tree_pool::no_boost(Instance* instance) {
     std::poisson_distribution<int> poisson_distr(lambda);
     double k = poisson_distr(mrand);
 
-    double weight = instance->getWeight();
-    if (k > 0 && weight > 0) {
-        instance->setWeight(k * weight);
-
-        tree->train(*instance);
-        instance->setWeight(weight);
+    if (k > 0) {
+        tree->train(*instance, k);
     }
 }
 
 void trans_pearl::boosted_bg_tree_pool::ozaboost(Instance* instance) {
     double lambda_d = 1;
-    instance->setWeight(1);
 
     for (int i = 0; i < pool.size(); i++) {
         auto tree = pool[i];
@@ -935,12 +1013,8 @@ void trans_pearl::boosted_bg_tree_pool::ozaboost(Instance* instance) {
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
 
-        double weight = instance->getWeight();
-        if (k > 0 && weight > 0) {
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+        if (k > 0) {
+            tree->train(*instance, k);
         }
 
         oob_tree_lam_sum[i] += lambda_d;
@@ -967,7 +1041,6 @@ void trans_pearl::boosted_bg_tree_pool::ozaboost(Instance* instance) {
 
 void trans_pearl::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_same_distribution) {
     double lambda_d = 1;
-    instance->setWeight(1);
 
     for (int i = 0; i < pool.size(); i++) {
         auto tree = pool[i];
@@ -976,12 +1049,8 @@ void trans_pearl::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_s
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
 
-        double weight = instance->getWeight();
-        if (k > 0 && weight > 0) {
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+        if (k > 0) {
+            tree->train(*instance, k);
         }
 
         oob_tree_lam_sum[i] += lambda_d;
@@ -1021,7 +1090,6 @@ void trans_pearl::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_s
 
 void trans_pearl::boosted_bg_tree_pool::otradaboost(Instance* instance, bool is_same_distribution) {
     double lambda_d = 1;
-    instance->setWeight(1);
 
     // cout << "lamb: " ;
     for (int i = 0; i < pool.size(); i++) {
@@ -1031,12 +1099,8 @@ void trans_pearl::boosted_bg_tree_pool::otradaboost(Instance* instance, bool is_
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
 
-        double weight = instance->getWeight();
-        if (k > 0 && weight > 0) {
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+        if (k > 0) {
+            tree->train(*instance, k);
         }
 
         // boosting based on out-of-bag errors
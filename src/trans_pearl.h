@@ -4,6 +4,14 @@
 #include "PEARL/src/cpp/pearl.h"
 #include "knn-cpp/include/knn/kdtree_minkowski.h"
 
+#include "model_snapshot.h"
+#include "load_shedder.h"
+#include "weighted_training.h"
+#include "columnar_store.h"
+#include "knn_index_cache.h"
+#include "pseudo_instance_batch.h"
+#include "splittable_rng.h"
+
 typedef Eigen::MatrixXd Matrix;
 typedef knn::Matrixi Matrixi;
 
@@ -61,6 +69,23 @@ class trans_pearl : public pearl {
         shared_ptr<trans_pearl_tree> match_concept(vector<Instance*> warning_period_instances);
         int get_transferred_tree_group_size() const;
         vector<int> transferred_foreground_pos_list;
+
+        // serving: lock-free predictions from a periodically refreshed copy of the foreground trees
+        void set_snapshot_staleness(int max_instances, int max_millis);
+        void publish_snapshot();
+        int predict_snapshot();
+        int predict_snapshot(Instance& instance);
+
+        // float64, float32, uint16 or uint8 columns for instances retained afterwards
+        void set_instance_store_encoding(string encoding_str);
+
+        // kdtree (exact) or rp_forest (approximate) neighbour search for
+        // pseudo-instance generation; more trees raise recall and latency
+        void set_neighbour_search(string search_str, int num_trees, int leaf_size);
+
+        // adaptive load shedding when training falls behind the target rate
+        void set_load_shedding(double target_rate);
+        vector<long> get_load_shedding_stats();
         int transferred_tree_total_count = 0;
 
 private:
@@ -74,6 +99,21 @@ private:
                                           shared_ptr<arf_tree>& tree2);
         bool detect_stability(int error_count, unique_ptr<HT::ADWIN>& detector);
 
+        // rows kept by the trees' instance stores, appended once per instance
+        instance_log retained_log;
+
+        // each transfer pool gets its own stream split off this one
+        splittable_rng pool_rand;
+
+        neighbour_search_enum neighbour_search = neighbour_search_enum::kdtree_search;
+        int neighbour_search_trees = 8;
+        int neighbour_search_leaf_size = 32;
+
+        // serving
+        snapshot_policy snapshot_refresh;
+        rcu_cell<model_snapshot> snapshot;
+        load_shedder load_shedding;
+
         // Transfer
         vector<vector<shared_ptr<pearl_tree>>*> registered_tree_pools;
         int evaluate_tree(shared_ptr<trans_pearl_tree> drifted_tree, vector<Instance*> &pseudo_instances);
@@ -105,13 +145,15 @@ private:
         class boosted_bg_tree_pool {
         public:
             boost_modes boost_mode = otradaboost_mode;
+            bool enable_perf_eval = true;
 
             boosted_bg_tree_pool(enum boost_modes boost_mode,
                                  int pool_size,
                                  int eviction_interval,
                                  double transfer_kappa_threshold,
                                  shared_ptr<trans_pearl_tree> tree_template,
-                                 int lambda);
+                                 int lambda,
+                                 splittable_rng mrand);
 
             // training starts when a mini_batch is ready
             void train(Instance* instance, bool is_same_distribution);
@@ -122,11 +164,13 @@ private:
             vector<Instance*> warning_period_instances;
             shared_ptr<trans_pearl_tree> matched_tree = nullptr;
             int instance_store_idx = 0;
+            // replayed source rows are materialized here
+            DenseInstance replay_instance;
 
         private:
             double lambda = 1;
             double epsilon = 1;
-            std::mt19937 mrand;
+            splittable_rng mrand;
 
             long pool_size = 10;
             long bbt_counter = 0;
@@ -163,15 +207,35 @@ public:
 
     // 1. For matching a concept by running other trees in other domains on it
     // 2. For generating data by using KNN
-    deque<Instance*> instance_store;
+    columnar_store instance_store;
     int instance_store_size;
 
-    void store_instance(Instance* instance);
+    // true while this tree or its background tree still has room
+    bool is_storing() const;
+    void store_instance(instance_log& log, long row);
+    // instances are read-only once ingested, the training weight is passed per call
+    void train(const Instance& instance, double weight, bool train_bg_tree = true);
+    using pearl_tree::train;
 
+    // the caller owns the returned instances
     vector<Instance*> generate_data(Instance* instance, int num_instances);
-    vector<DenseInstance*> find_k_closest_instances(DenseInstance* target_instance,
-                                                    deque<Instance*>& instance_store,
-                                                    int k);
+    // writes num_instances pseudo-instances into batch, returns false if too few instances are stored
+    bool generate_batch(Instance* instance, int num_instances, pseudo_instance_batch& batch);
+    // row of instance_store closest to each batch row on its modified attributes and label
+    void find_closest_instances(const pseudo_instance_batch& batch, vector<int>& close_instance_indices);
+    void set_neighbour_search(neighbour_search_enum search, int num_trees, int leaf_size);
+
+private:
+    // per-projection neighbour indices over instance_store, reused across generate_data calls
+    knn_index_cache knn_indices;
+
+    // scratch space reused across batches
+    pseudo_instance_batch pseudo_batch;
+    vector<int> close_instance_indices;
+    vector<int> batch_order;
+    vector<int> projection;
+    Matrix query_points;
+    Matrixi neighbour_indices;
 };
 
 #endif
\ No newline at end of file
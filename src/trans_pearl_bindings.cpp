@@ -5,6 +5,7 @@
 #include "trans_pearl.h"
 #include "trans_pearl_wrapper.h"
 #include "trans_tree_wrapper.h"
+#include "learner_host.h"
 
 // PYBIND11_MAKE_OPAQUE(vector<Instance*>);
 // PYBIND11_MAKE_OPAQUE(vector<shared_ptr<pearl_tree>>);
@@ -14,6 +15,9 @@ namespace py = pybind11;
 PYBIND11_MODULE(trans_pearl_wrapper, m) {
     m.doc() = "trans_pearl's implementation in C++";
 
+    m.def("benchmark_neighbour_search", &benchmark_neighbour_search);
+    m.def("benchmark_observer_kernels", &benchmark_observer_kernels);
+
     // py::class_<std::vector<Instance*>>(m, "IntInstance")
     //         .def(py::init<>())
     //         .def("clear", &std::vector<Instance*>::clear)
@@ -153,7 +157,12 @@ PYBIND11_MODULE(trans_pearl_wrapper, m) {
                 .def("get_next_instance", &trans_pearl_wrapper::get_next_instance)
                 .def("get_candidate_tree_group_size", &trans_pearl_wrapper::get_candidate_tree_group_size)
                 .def("get_transferred_tree_group_size", &trans_pearl_wrapper::get_transferred_tree_group_size)
-                .def("get_tree_pool_size", &trans_pearl_wrapper::get_tree_pool_size);
+                .def("get_tree_pool_size", &trans_pearl_wrapper::get_tree_pool_size)
+                .def("set_snapshot_staleness", &trans_pearl_wrapper::set_snapshot_staleness)
+                .def("predict_snapshot", &trans_pearl_wrapper::predict_snapshot)
+                .def("set_load_shedding", &trans_pearl_wrapper::set_load_shedding)
+                .def("set_instance_store_encoding", &trans_pearl_wrapper::set_instance_store_encoding)
+                .def("get_load_shedding_stats", &trans_pearl_wrapper::get_load_shedding_stats);
 
 
 
@@ -186,6 +195,76 @@ PYBIND11_MODULE(trans_pearl_wrapper, m) {
             .def("init_data_source", &trans_tree_wrapper::init_data_source)
             .def("get_next_instance", &trans_tree_wrapper::get_next_instance)
             .def("get_transferred_tree_group_size", &trans_tree_wrapper::get_transferred_tree_group_size)
-            .def("get_tree_pool_size", &trans_tree_wrapper::get_tree_pool_size);
+            .def("get_tree_pool_size", &trans_tree_wrapper::get_tree_pool_size)
+            .def("set_snapshot_staleness", &trans_tree_wrapper::set_snapshot_staleness)
+            .def("predict_snapshot", &trans_tree_wrapper::predict_snapshot)
+            .def("enable_async_training", &trans_tree_wrapper::enable_async_training)
+            .def("get_training_queue_stats", &trans_tree_wrapper::get_training_queue_stats)
+            .def("set_load_shedding", &trans_tree_wrapper::set_load_shedding)
+            .def("set_instance_store_encoding", &trans_tree_wrapper::set_instance_store_encoding)
+            .def("get_load_shedding_stats", &trans_tree_wrapper::get_load_shedding_stats)
+            .def("set_spill_threshold", &trans_tree_wrapper::set_spill_threshold)
+            .def("get_spill_stats", &trans_tree_wrapper::get_spill_stats)
+            .def("set_instance_summary_size", &trans_tree_wrapper::set_instance_summary_size)
+            .def("set_tree_backend", &trans_tree_wrapper::set_tree_backend)
+            .def("set_deferred_reclamation", &trans_tree_wrapper::set_deferred_reclamation)
+            .def("get_reclamation_stats", &trans_tree_wrapper::get_reclamation_stats)
+            .def("set_pool_drift_detector", &trans_tree_wrapper::set_pool_drift_detector)
+            .def("set_memory_budget", &trans_tree_wrapper::set_memory_budget)
+            .def("get_tree_model_bytes", &trans_tree_wrapper::get_tree_model_bytes)
+            .def("set_shared_pool_observations", &trans_tree_wrapper::set_shared_pool_observations)
+            .def("set_discretization", &trans_tree_wrapper::set_discretization)
+            .def("set_observer_isa", &trans_tree_wrapper::set_observer_isa)
+            .def("set_adaptive_grace_period", &trans_tree_wrapper::set_adaptive_grace_period)
+            .def("get_split_attempt_stats", &trans_tree_wrapper::get_split_attempt_stats)
+            .def("set_split_workers", &trans_tree_wrapper::set_split_workers)
+            .def("get_split_scheduler_stats", &trans_tree_wrapper::get_split_scheduler_stats)
+            .def("set_attribute_workers", &trans_tree_wrapper::set_attribute_workers)
+            .def("set_replay_batch_size", &trans_tree_wrapper::set_replay_batch_size);
+
+    // every tenant gets a trans_tree built from the same params
+    py::class_<learner_host>(m, "learner_host")
+            .def(py::init([](int num_workers,
+                             int quantum,
+                             int hibernate_after_millis,
+                             int seed,
+                             int kappa_window_size,
+                             double warning_delta,
+                             double drift_delta,
+                             // transfer learning params
+                             int least_transfer_warning_period_instances_length,
+                             int instance_store_size,
+                             int num_diff_distr_instances,
+                             int bbt_pool_size,
+                             int eviction_interval,
+                             double transfer_kappa_threshold,
+                             double gamma,
+                             double transfer_match_lowerbound,
+                             string boost_mode_str) {
+                return make_unique<learner_host>(num_workers, quantum, hibernate_after_millis, [=] {
+                    return make_shared<trans_tree>(seed,
+                                                   kappa_window_size,
+                                                   warning_delta,
+                                                   drift_delta,
+                                                   least_transfer_warning_period_instances_length,
+                                                   instance_store_size,
+                                                   num_diff_distr_instances,
+                                                   bbt_pool_size,
+                                                   eviction_interval,
+                                                   transfer_kappa_threshold,
+                                                   gamma,
+                                                   transfer_match_lowerbound,
+                                                   boost_mode_str);
+                });
+            }))
+            .def("add_tenant", &learner_host::add_tenant)
+            .def("init_data_source", &learner_host::init_data_source)
+            .def("submit_next", &learner_host::submit_next)
+            .def("flush", &learner_host::flush, py::call_guard<py::gil_scoped_release>())
+            .def("get_memory_estimate", &learner_host::get_memory_estimate)
+            .def("get_total_memory_estimate", &learner_host::get_total_memory_estimate)
+            .def("get_tenant_stats", &learner_host::get_tenant_stats)
+            .def("get_num_hibernated", &learner_host::get_num_hibernated)
+            .def_readwrite("accounting_interval", &learner_host::accounting_interval);
 
 }
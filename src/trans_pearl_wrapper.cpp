@@ -142,3 +142,57 @@ int trans_pearl_wrapper::get_transferred_tree_group_size() {
 int trans_pearl_wrapper::get_tree_pool_size() {
     return current_classifier->get_tree_pool_size();
 }
+
+void trans_pearl_wrapper::set_snapshot_staleness(int max_instances, int max_millis) {
+    for (auto& classifier : classifiers) {
+        shared_ptr<trans_pearl> trans_pearl_classifier = dynamic_pointer_cast<trans_pearl>(classifier);
+        if (trans_pearl_classifier == nullptr) {
+            cout << "set_snapshot_staleness: snapshots require transfer mode" << endl;
+            exit(1);
+        }
+        trans_pearl_classifier->set_snapshot_staleness(max_instances, max_millis);
+    }
+}
+
+int trans_pearl_wrapper::predict_snapshot() {
+    shared_ptr<trans_pearl> trans_pearl_classifier = static_pointer_cast<trans_pearl>(current_classifier);
+    return trans_pearl_classifier->predict_snapshot();
+}
+
+void trans_pearl_wrapper::set_load_shedding(double target_rate) {
+    for (auto& classifier : classifiers) {
+        shared_ptr<trans_pearl> trans_pearl_classifier = dynamic_pointer_cast<trans_pearl>(classifier);
+        if (trans_pearl_classifier == nullptr) {
+            cout << "set_load_shedding: load shedding requires transfer mode" << endl;
+            exit(1);
+        }
+        trans_pearl_classifier->set_load_shedding(target_rate);
+    }
+}
+
+void trans_pearl_wrapper::set_instance_store_encoding(string encoding_str) {
+    for (auto& classifier : classifiers) {
+        shared_ptr<trans_pearl> trans_pearl_classifier = dynamic_pointer_cast<trans_pearl>(classifier);
+        if (trans_pearl_classifier == nullptr) {
+            cout << "set_instance_store_encoding: instance stores require transfer mode" << endl;
+            exit(1);
+        }
+        trans_pearl_classifier->set_instance_store_encoding(encoding_str);
+    }
+}
+
+void trans_pearl_wrapper::set_neighbour_search(string search_str, int num_trees, int leaf_size) {
+    for (auto& classifier : classifiers) {
+        shared_ptr<trans_pearl> trans_pearl_classifier = dynamic_pointer_cast<trans_pearl>(classifier);
+        if (trans_pearl_classifier == nullptr) {
+            cout << "set_neighbour_search: neighbour search requires transfer mode" << endl;
+            exit(1);
+        }
+        trans_pearl_classifier->set_neighbour_search(search_str, num_trees, leaf_size);
+    }
+}
+
+vector<long> trans_pearl_wrapper::get_load_shedding_stats() {
+    shared_ptr<trans_pearl> trans_pearl_classifier = static_pointer_cast<trans_pearl>(current_classifier);
+    return trans_pearl_classifier->get_load_shedding_stats();
+}
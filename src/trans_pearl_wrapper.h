@@ -57,6 +57,14 @@ public:
     int get_transferred_tree_group_size();
     int get_tree_pool_size();
 
+    void set_snapshot_staleness(int max_instances, int max_millis);
+    int predict_snapshot();
+
+    void set_load_shedding(double target_rate);
+    void set_instance_store_encoding(string encoding_str);
+    void set_neighbour_search(string search_str, int num_trees, int leaf_size);
+    vector<long> get_load_shedding_stats();
+
 private:
 
     vector<shared_ptr<pearl>> classifiers;
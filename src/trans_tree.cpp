@@ -27,7 +27,7 @@ trans_tree::trans_tree(
     transfer_match_lowerbound(transfer_match_lowerbound),
     gamma(gamma) {
 
-    mrand = std::mt19937(seed);
+    mrand = splittable_rng(seed);
 
     if (boost_mode_map.find(boost_mode_str) == boost_mode_map.end() ) {
         if (boost_mode_str == "disable_transfer") {
@@ -42,6 +42,11 @@ trans_tree::trans_tree(
 
 }
 
+trans_tree::~trans_tree() {
+    // stop the training thread before the trees it trains are destroyed
+    async_training = nullptr;
+}
+
 double compute_kappa(deque<int> predicted_labels, deque<int> actual_labels, int class_count) {
     if (predicted_labels.size() != actual_labels.size()) {
         return std::numeric_limits<double>::min();
@@ -93,27 +98,78 @@ double compute_kappa(deque<int> predicted_labels, deque<int> actual_labels, int
 void trans_tree::init() {
     foreground_tree = make_tree(0);
 
-    bbt_pool = make_unique<boosted_bg_tree_pool>(
-            boost_mode,
-            bbt_pool_size,
-            eviction_interval,
-            transfer_kappa_threshold,
-            make_tree(-1),
-            1);
+    bbt_pool = make_bbt_pool(make_tree(-1));
 
     foreground_tree->tree_pool_id = tree_pool.size();
     tree_pool.push_back(foreground_tree);
+    tree_pool_size = tree_pool.size();
+
+    if (snapshot_refresh.is_enabled()) {
+        publish_snapshot();
+    }
 }
 
 shared_ptr<hoeffding_tree> trans_tree::make_tree(int tree_pool_id) {
-    return make_shared<hoeffding_tree>(warning_delta, drift_delta, instance_store_size);
+    shared_ptr<hoeffding_tree> tree = make_shared<hoeffding_tree>(warning_delta, drift_delta, instance_store_size);
+    if (instance_summary_size > 0) {
+        tree->instance_summary = make_shared<coreset_summary>(instance_summary_size);
+    }
+    if (use_compact_trees) {
+        tree->use_compact_tree();
+        tree->compact_tree->set_memory_budget(tree_memory_budget);
+        if (discretizer != nullptr) {
+            tree->compact_tree->set_num_bins(discretizer->get_num_bins());
+        }
+        tree->compact_tree->set_adaptive_grace_period(adaptive_grace_period);
+        tree->compact_tree->set_split_scheduler(split_workers);
+        tree->compact_tree->set_attribute_workers(vertical_workers, min_parallel_attributes);
+    }
+    return tree;
+}
+
+// pool members are copies of tree_template and share the pool's budget
+unique_ptr<trans_tree::boosted_bg_tree_pool> trans_tree::make_bbt_pool(shared_ptr<hoeffding_tree> tree_template) {
+    if (tree_template->compact_tree != nullptr) {
+        // a no_boost pool holds a single member
+        int num_members = boost_mode == boost_modes_enum::no_boost_mode ? 1 : bbt_pool_size;
+        tree_template->compact_tree->set_memory_budget(pool_memory_budget / num_members);
+    }
+
+    unique_ptr<boosted_bg_tree_pool> pool = make_unique<boosted_bg_tree_pool>(
+            boost_mode,
+            bbt_pool_size,
+            eviction_interval,
+            transfer_kappa_threshold,
+            tree_template,
+            1,
+            mrand.split(),
+            pool_drift_detector,
+            drift_delta,
+            share_pool_observations);
+    pool->reclaimer = reclaimer;
+    return pool;
 }
 
 void trans_tree::train() {
+    if (async_training != nullptr) {
+        async_training->enqueue(instance);
+        return;
+    }
+
+    train_instance(instance);
+}
+
+void trans_tree::train_instance(shared_ptr<Instance> instance) {
+    if (is_hibernated()) {
+        wake();
+    }
     if (foreground_tree == nullptr) {
+        instance_information = instance->getInstanceInformation();
         init();
     }
 
+    load_shedding.begin_instance();
+
     int actual_label = instance->getLabel();
     if (actual_labels.size() >= kappa_window_size) {
         actual_labels.pop_front();
@@ -121,11 +177,16 @@ void trans_tree::train() {
     actual_labels.push_back(actual_label);
 
     if (enable_transfer) {
-        foreground_tree->store_instance(instance);
+        if (foreground_tree->is_storing()) {
+            foreground_tree->store_instance(*instance, retained_log);
+        }
         transfer(instance);
     }
 
-    foreground_tree->train(*instance);
+    if (!load_shedding.skip_foreground()) {
+        bool train_bg_tree = foreground_tree->bg_tree == nullptr || !load_shedding.skip_background();
+        foreground_tree->train(*instance, instance->getWeight(), train_bg_tree);
+    }
 
     int predicted_label = foreground_tree->predict(*instance, true);
     int error_count = (int) (predicted_label != actual_label);
@@ -147,22 +208,21 @@ void trans_tree::train() {
         }
         foreground_tree->tree_pool_id = tree_pool.size();
         tree_pool.push_back(foreground_tree);
+        tree_pool_size = tree_pool.size();
+        spill_archived_stores();
 
         if (bbt_pool == nullptr) {
             shared_ptr<hoeffding_tree> tree_template =
                     make_shared<hoeffding_tree>(*make_tree(-1));
-            bbt_pool = make_unique<boosted_bg_tree_pool>(
-                    boost_mode,
-                    bbt_pool_size,
-                    eviction_interval,
-                    transfer_kappa_threshold,
-                    tree_template,
-                    1);
+            bbt_pool = make_bbt_pool(tree_template);
         }
     }
 
     // detect warning
     if (detect_change(error_count, foreground_tree->warning_detector)) {
+        if (reclaimer != nullptr) {
+            reclaimer->retire(std::move(foreground_tree->bg_tree));
+        }
         foreground_tree->bg_tree = make_tree(-1);
         foreground_tree->warning_detector->resetChange();
 
@@ -171,18 +231,20 @@ void trans_tree::train() {
 
             shared_ptr<hoeffding_tree> tree_template =
                     make_shared<hoeffding_tree>(*foreground_tree->bg_tree);
-            bbt_pool = make_unique<boosted_bg_tree_pool>(
-                    boost_mode,
-                    bbt_pool_size,
-                    eviction_interval,
-                    transfer_kappa_threshold,
-                    tree_template,
-                    1);
+            retire_bbt_pool();
+            bbt_pool = make_bbt_pool(tree_template);
         }
     }
+
+    num_instances_trained++;
+    if (snapshot_refresh.on_train()) {
+        publish_snapshot();
+    }
+
+    load_shedding.end_instance();
 }
 
-bool trans_tree::transfer(Instance* instance) {
+bool trans_tree::transfer(const shared_ptr<Instance>& instance) {
     if (bbt_pool == nullptr) {
         return false;
     }
@@ -198,7 +260,8 @@ bool trans_tree::transfer(Instance* instance) {
         return false;
     }
 
-    bbt_pool->online_boost(instance, true);
+    bbt_pool->enable_perf_eval = !load_shedding.skip_perf_eval();
+    bbt_pool->online_boost(instance.get(), true);
 
     if (bbt_pool->matched_tree == nullptr) {
         // During drift warning period
@@ -213,19 +276,30 @@ bool trans_tree::transfer(Instance* instance) {
             shared_ptr<hoeffding_tree> matched_tree =
                     match_concept(bbt_pool->warning_period_instances);
             if (matched_tree == nullptr) {
-                bbt_pool = nullptr;
+                retire_bbt_pool();
                 return false;
             } else {
                 bbt_pool->matched_tree = matched_tree;
+                if (matched_tree->instance_summary != nullptr) {
+                    bbt_pool->replay_summary = make_unique<coreset_summary>(*matched_tree->instance_summary);
+                } else {
+                    bbt_pool->replay_store = matched_tree->instance_store.load_resident();
+                }
             }
         }
     }
 
     // After tree matching, perform boosting with weight decrement
-    for (int j = 0; j < num_diff_distr_instances; j++) {
-        Instance* transfer_instance = bbt_pool->get_next_diff_distr_instance();
-        if (transfer_instance != nullptr) {
-            bbt_pool->online_boost(transfer_instance, false);
+    if (!load_shedding.skip_replay()) {
+        if (replay_batch_size > 0 && bbt_pool->boost_mode == boost_modes_enum::no_boost_mode) {
+            bbt_pool->replay_batch(num_diff_distr_instances, replay_batch_size);
+        } else {
+            for (int j = 0; j < num_diff_distr_instances; j++) {
+                Instance* transfer_instance = bbt_pool->get_next_diff_distr_instance();
+                if (transfer_instance != nullptr) {
+                    bbt_pool->online_boost(transfer_instance, false);
+                }
+            }
         }
     }
 
@@ -243,12 +317,20 @@ bool trans_tree::transfer(Instance* instance) {
     if (transfer_candidate->kappa - foreground_tree->kappa >= transfer_kappa_threshold
         && transfer_candidate->kappa >= transfer_kappa_threshold) {
 
+        if (transfer_candidate->compact_tree != nullptr) {
+            transfer_candidate->compact_tree->unshare_root();
+            // it leaves the pool's budget, the leaves it had to drop are reactivated at the next check
+            transfer_candidate->compact_tree->set_memory_budget(tree_memory_budget);
+        }
         transfer_candidate->tree_pool_id = tree_pool.size();
         tree_pool.push_back(transfer_candidate);
+        tree_pool_size = tree_pool.size();
 
+        seed_detectors(*transfer_candidate);
         foreground_tree = transfer_candidate;
+        spill_archived_stores();
         transferred_tree_total_count += 1;
-        bbt_pool = nullptr; // TODO reduce overhead
+        retire_bbt_pool();
         cout << "transferred tree kappa: " << transfer_candidate->kappa
              << " | "
              << "foreground tree kappa: " << foreground_tree->kappa << endl;
@@ -257,7 +339,7 @@ bool trans_tree::transfer(Instance* instance) {
     return true;
 }
 
-shared_ptr<hoeffding_tree> trans_tree::match_concept(vector<Instance*> warning_period_instances) {
+shared_ptr<hoeffding_tree> trans_tree::match_concept(const vector<shared_ptr<Instance>>& warning_period_instances) {
     shared_ptr<hoeffding_tree> matched_tree = nullptr;
     double highest_kappa = transfer_match_lowerbound;
     int matched_tree_idx = -1;
@@ -265,7 +347,7 @@ shared_ptr<hoeffding_tree> trans_tree::match_concept(vector<Instance*> warning_p
     // For kappa calculation
     int class_count = warning_period_instances[0]->getNumberClasses();
     deque<int> true_labels;
-    for (auto warning_period_instance : warning_period_instances) {
+    for (auto& warning_period_instance : warning_period_instances) {
         true_labels.push_back(warning_period_instance->getLabel());
     }
 
@@ -274,7 +356,7 @@ shared_ptr<hoeffding_tree> trans_tree::match_concept(vector<Instance*> warning_p
             auto trans_tree = (*registered_tree_pool)[i];
 
             deque<int> predicted_labels;
-            for (auto warning_period_instance : warning_period_instances) {
+            for (auto& warning_period_instance : warning_period_instances) {
                 int prediction = trans_tree->predict(*warning_period_instance, false);
                 predicted_labels.push_back(prediction);
             }
@@ -311,19 +393,521 @@ vector<shared_ptr<hoeffding_tree>>& trans_tree::get_concept_repo() {
 }
 
 int trans_tree::predict() {
+    if (async_training != nullptr) {
+        // the learner belongs to the training thread
+        return predict_snapshot(*instance);
+    }
+
+    return predict_instance(instance.get());
+}
+
+int trans_tree::predict_instance(Instance* instance) {
+    if (is_hibernated()) {
+        wake();
+    }
     if (foreground_tree == nullptr) {
+        instance_information = instance->getInstanceInformation();
         init();
     }
 
     return foreground_tree->predict(*instance, true);
 }
 
+void trans_tree::set_snapshot_staleness(int max_instances, int max_millis) {
+    snapshot_refresh.set_staleness(max_instances, max_millis);
+    if (foreground_tree != nullptr) {
+        publish_snapshot();
+    }
+}
+
+// must be called from the thread that trains this learner
+void trans_tree::publish_snapshot() {
+    unique_ptr<model_snapshot> next_snapshot = make_unique<model_snapshot>(num_instances_trained);
+    if (foreground_tree->compact_tree != nullptr) {
+        next_snapshot->add_tree(*foreground_tree->compact_tree);
+    } else {
+        next_snapshot->add_tree(*foreground_tree->tree);
+    }
+    snapshot.publish(std::move(next_snapshot));
+    snapshot_refresh.on_publish();
+}
+
+int trans_tree::predict_snapshot() {
+    return predict_snapshot(*instance);
+}
+
+// safe to call from any thread while another thread trains
+int trans_tree::predict_snapshot(Instance& instance) {
+    auto cur_snapshot = snapshot.read();
+    if (!cur_snapshot) {
+        // nothing published yet
+        return 0;
+    }
+
+    return cur_snapshot->predict(instance);
+}
+
+void trans_tree::enable_async_training(int queue_capacity, string overflow_policy) {
+    if (async_training != nullptr) {
+        cout << "async training is already enabled" << endl;
+        exit(1);
+    }
+
+    if (!snapshot_refresh.is_enabled()) {
+        snapshot_refresh.set_staleness(1000, -1);
+    }
+    if (foreground_tree != nullptr && snapshot.empty()) {
+        publish_snapshot();
+    }
+
+    async_training = make_unique<training_queue>(
+            queue_capacity,
+            overflow_policy,
+            [this](shared_ptr<Instance> queued_instance) {
+                // the caller predicts from the snapshot, so the foreground tree's own prediction is
+                // recorded here, keeping the kappa window used for transfer the same as in sync mode
+                predict_instance(queued_instance.get());
+                train_instance(queued_instance);
+            });
+}
+
+void trans_tree::flush_training_queue() {
+    if (async_training != nullptr) {
+        async_training->flush();
+    }
+}
+
+// enqueued, trained, dropped, subsampled, lag, max lag
+vector<long> trans_tree::get_training_queue_stats() {
+    if (async_training == nullptr) {
+        return vector<long>(6, 0);
+    }
+
+    return {
+        async_training->get_enqueued_count(),
+        async_training->get_trained_count(),
+        async_training->get_dropped_count(),
+        async_training->get_subsampled_count(),
+        async_training->get_lag(),
+        async_training->get_max_lag()
+    };
+}
+
+void trans_tree::set_instance_store_encoding(string encoding_str) {
+    retained_log.set_encoding(parse_value_encoding(encoding_str));
+}
+
+void trans_tree::set_instance_summary_size(int max_representatives) {
+    if (max_representatives < 0) {
+        cout << "set_instance_summary_size: max_representatives must not be negative" << endl;
+        exit(1);
+    }
+    instance_summary_size = max_representatives;
+}
+
+void trans_tree::set_deferred_reclamation(bool enabled) {
+    reclaimer = enabled ? &deferred_reclaimer::get_process_reclaimer() : nullptr;
+    if (bbt_pool != nullptr) {
+        bbt_pool->reclaimer = reclaimer;
+    }
+}
+
+vector<long> trans_tree::get_reclamation_stats() {
+    deferred_reclaimer& process_reclaimer = deferred_reclaimer::get_process_reclaimer();
+    return { process_reclaimer.get_retired_count(), process_reclaimer.get_pending_count() };
+}
+
+// pool members are watched by the pool's detector bank, so their own detectors
+// have seen nothing. A transferred member starts with its errors over the kappa
+// window, which its predicted_labels cover, instead of its full history.
+void trans_tree::seed_detectors(hoeffding_tree& tree) {
+    for (int i = 0; i < actual_labels.size(); i++) {
+        int error_count = (int) (tree.predicted_labels[i] != actual_labels[i]);
+        tree.warning_detector->setInput(error_count);
+        tree.drift_detector->setInput(error_count);
+    }
+    tree.warning_detector->resetChange();
+    tree.drift_detector->resetChange();
+}
+
+void trans_tree::retire_bbt_pool() {
+    if (reclaimer != nullptr && bbt_pool != nullptr) {
+        reclaimer->retire(shared_ptr<boosted_bg_tree_pool>(std::move(bbt_pool)));
+    }
+    bbt_pool = nullptr;
+}
+
+void trans_tree::set_pool_drift_detector(string detector_str) {
+    pool_drift_detector = parse_drift_detector(detector_str);
+}
+
+void trans_tree::set_memory_budget(long tree_bytes, long pool_bytes) {
+    if (!use_compact_trees) {
+        cout << "set_memory_budget: memory budgets need the compact tree backend" << endl;
+        exit(1);
+    }
+    tree_memory_budget = tree_bytes;
+    pool_memory_budget = pool_bytes;
+}
+
+void trans_tree::set_discretizer(shared_ptr<quantile_discretizer> discretizer) {
+    this->discretizer = discretizer;
+}
+
+void trans_tree::set_observer_isa(string isa_str) {
+    ::set_observer_isa(parse_observer_isa(isa_str));
+}
+
+void trans_tree::set_adaptive_grace_period(bool enabled) {
+    if (enabled && !use_compact_trees) {
+        cout << "set_adaptive_grace_period: the adaptive grace period needs the compact tree backend" << endl;
+        exit(1);
+    }
+    adaptive_grace_period = enabled;
+}
+
+vector<long> trans_tree::get_split_attempt_stats() {
+    long attempts = 0;
+    long saved = 0;
+    for (auto& tree : tree_pool) {
+        tree->count_split_attempts(attempts, saved);
+    }
+    // archived trees still point to the background tree that replaced them
+    if (foreground_tree != nullptr && foreground_tree->bg_tree != nullptr) {
+        foreground_tree->bg_tree->count_split_attempts(attempts, saved);
+    }
+    if (bbt_pool != nullptr) {
+        bbt_pool->count_split_attempts(attempts, saved);
+    }
+    return { attempts, saved };
+}
+
+// trees made before keep evaluating inline
+void trans_tree::set_split_workers(int num_workers) {
+    if (num_workers > 0 && !use_compact_trees) {
+        cout << "set_split_workers: split workers need the compact tree backend" << endl;
+        exit(1);
+    }
+    if (num_workers <= 0) {
+        split_workers = nullptr;
+        return;
+    }
+    split_workers = make_shared<split_scheduler>(num_workers);
+}
+
+vector<long> trans_tree::get_split_scheduler_stats() {
+    if (split_workers == nullptr) {
+        return { 0, 0 };
+    }
+    return { split_workers->get_submitted_count(), split_workers->get_inline_count() };
+}
+
+void trans_tree::set_replay_batch_size(int batch_size) {
+    replay_batch_size = std::max(batch_size, 0);
+}
+
+// trees made before keep running serially
+void trans_tree::set_attribute_workers(int num_workers, int min_attributes) {
+    if (num_workers > 0 && !use_compact_trees) {
+        cout << "set_attribute_workers: attribute workers need the compact tree backend" << endl;
+        exit(1);
+    }
+    if (num_workers <= 0) {
+        vertical_workers = nullptr;
+        return;
+    }
+    vertical_workers = make_shared<attribute_workers>(num_workers);
+    min_parallel_attributes = min_attributes;
+}
+
+void trans_tree::set_shared_pool_observations(bool enabled) {
+    if (enabled && !use_compact_trees) {
+        cout << "set_shared_pool_observations: shared observations need the compact tree backend" << endl;
+        exit(1);
+    }
+    share_pool_observations = enabled;
+}
+
+vector<long> trans_tree::get_tree_model_bytes() {
+    vector<long> model_bytes;
+    for (auto& tree : tree_pool) {
+        model_bytes.push_back(tree->get_model_bytes());
+    }
+    if (bbt_pool != nullptr) {
+        bbt_pool->collect_model_bytes(model_bytes);
+    }
+    return model_bytes;
+}
+
+void trans_tree::set_tree_backend(string backend_str) {
+    if (backend_str == "streamdm") {
+        use_compact_trees = false;
+    } else if (backend_str == "compact") {
+        use_compact_trees = true;
+    } else {
+        cout << "Invalid tree backend: " << backend_str << endl;
+        exit(1);
+    }
+}
+
+void trans_tree::set_spill_threshold(long threshold_bytes) {
+    spill_threshold = threshold_bytes;
+    if (!is_hibernated() && foreground_tree != nullptr) {
+        spill_archived_stores();
+    }
+}
+
+vector<long> trans_tree::get_spill_stats() {
+    long num_spilled_stores = hibernated_spilled_stores.size();
+    for (auto& tree : tree_pool) {
+        num_spilled_stores += (long) tree->instance_store.is_spilled();
+    }
+    spill_file& file = spill_file::get_process_spill_file();
+    return { num_spilled_stores, file.get_spilled_bytes(), file.get_unreleased_bytes() };
+}
+
+// the saving of a spill is approximated by the store's resident size, blocks
+// still shared with live stores are only freed with them
+void trans_tree::spill_archived_stores() {
+    if (spill_threshold <= 0) {
+        return;
+    }
+
+    long bytes = get_memory_estimate();
+    for (auto& tree : tree_pool) {
+        if (bytes <= spill_threshold) {
+            break;
+        }
+        if (tree == foreground_tree
+            || tree->instance_store.is_spilled()
+            || tree->instance_store.empty()) {
+            continue;
+        }
+
+        set<const void*> counted;
+        bytes -= tree->instance_store.get_memory_bytes(counted);
+        tree->instance_store.spill(spill_file::get_process_spill_file(), retained_log.get_encoding());
+        bytes += tree->instance_store.get_memory_bytes(counted);
+    }
+}
+
+void trans_tree::set_load_shedding(double target_rate) {
+    load_shedding.set_target_rate(target_rate);
+}
+
+// level, shed replays, shed perf_evals, shed background updates, shed foreground updates
+vector<long> trans_tree::get_load_shedding_stats() {
+    return load_shedding.get_stats();
+}
+
+// Packs the concept repo into a flat buffer and releases the trees.
+// The log blocks behind the instance stores are written once, followed by
+// each store's runs.
+// The foreground's background tree is packed with the repo; its detectors and
+// an untrained boosted pool stay in memory, so a woken learner carries on
+// where it stopped. A pool in a warning period or a replay is not packed.
+// The tree_pool vector stays registered with peers and is empty while asleep.
+bool trans_tree::hibernate() {
+    if (is_hibernated() || foreground_tree == nullptr) {
+        return is_hibernated();
+    }
+    if (async_training != nullptr) {
+        cout << "hibernate: learner is owned by its training thread" << endl;
+        exit(1);
+    }
+    // members trained during a warning period or a replay have no serialized form
+    if (bbt_pool != nullptr
+        && (bbt_pool->matched_tree != nullptr || !bbt_pool->warning_period_instances.empty())) {
+        return false;
+    }
+
+    // stores share log blocks, each block is written once
+    std::map<long, shared_ptr<column_block>> block_table;
+    for (auto& tree : tree_pool) {
+        tree->instance_store.collect_blocks(block_table);
+    }
+    shared_ptr<hoeffding_tree> bg_tree = foreground_tree->bg_tree;
+    if (bg_tree != nullptr) {
+        bg_tree->instance_store.collect_blocks(block_table);
+    }
+
+    string state;
+    write_value<int>(state, retained_log.get_block_size());
+    write_value<int>(state, block_table.size());
+    for (auto& entry : block_table) {
+        write_value<long>(state, entry.first);
+        entry.second->write_to(state, retained_log.get_encoding());
+    }
+    block_table.clear();
+
+    int foreground_idx = tree_pool.size() - 1;
+    write_value<int>(state, tree_pool.size());
+    for (int i = 0; i < tree_pool.size(); i++) {
+        auto& tree = tree_pool[i];
+        if (tree == foreground_tree) {
+            foreground_idx = i;
+        }
+        write_hibernated_tree(state, *tree);
+    }
+    write_value<int>(state, foreground_idx);
+    write_value<bool>(state, bg_tree != nullptr);
+    if (bg_tree != nullptr) {
+        write_hibernated_tree(state, *bg_tree);
+    }
+
+    write_value<int>(state, actual_labels.size());
+    for (int label : actual_labels) {
+        write_value<int>(state, label);
+    }
+    write_value<int>(state, foreground_tree->predicted_labels.size());
+    for (int label : foreground_tree->predicted_labels) {
+        write_value<int>(state, label);
+    }
+
+    // streamDM detectors cannot be serialized, they are small enough to keep
+    hibernated_warning_detector = std::move(foreground_tree->warning_detector);
+    hibernated_drift_detector = std::move(foreground_tree->drift_detector);
+
+    tree_pool.clear();
+    tree_pool.shrink_to_fit();
+    foreground_tree = nullptr;
+    actual_labels.clear();
+    retained_log.close_block();
+
+    hibernated_state = std::move(state);
+    return true;
+}
+
+void trans_tree::write_hibernated_tree(string& state, hoeffding_tree& tree) {
+    write_value<int>(state, tree.tree_pool_id);
+    write_value<double>(state, tree.kappa);
+    write_value<bool>(state, tree.compact_tree != nullptr);
+    if (tree.compact_tree != nullptr) {
+        tree.compact_tree->apply_pending_split();
+        tree.compact_tree->write_to(state);
+    } else {
+        write_bytes(state, serialize_tree(*tree.tree));
+    }
+    write_value<bool>(state, tree.instance_store.is_spilled());
+    if (tree.instance_store.is_spilled()) {
+        hibernated_spilled_stores.push_back(tree.instance_store);
+    } else {
+        tree.instance_store.write_runs(state);
+    }
+    write_value<bool>(state, tree.instance_summary != nullptr);
+    if (tree.instance_summary != nullptr) {
+        tree.instance_summary->write_to(state);
+    }
+}
+
+shared_ptr<hoeffding_tree> trans_tree::read_hibernated_tree(const string& state,
+                                                            size_t& pos,
+                                                            std::map<long, shared_ptr<column_block>>& block_table,
+                                                            int block_size,
+                                                            int& num_spilled_stores) {
+    shared_ptr<hoeffding_tree> tree = make_tree(-1);
+    tree->tree_pool_id = read_value<int>(state, pos);
+    tree->kappa = read_value<double>(state, pos);
+    if (read_value<bool>(state, pos)) {
+        tree->tree = nullptr;
+        tree->compact_tree = compact_hoeffding_tree::read_from(state, pos);
+        tree->compact_tree->set_split_scheduler(split_workers);
+        tree->compact_tree->set_attribute_workers(vertical_workers, min_parallel_attributes);
+    } else {
+        tree->compact_tree = nullptr;
+        tree->tree = deserialize_tree(read_bytes(state, pos));
+    }
+    if (read_value<bool>(state, pos)) {
+        tree->instance_store = std::move(hibernated_spilled_stores[num_spilled_stores++]);
+    } else {
+        tree->instance_store.read_runs(state, pos, block_table, block_size, instance_information);
+    }
+    tree->instance_summary = nullptr;
+    if (read_value<bool>(state, pos)) {
+        tree->instance_summary = coreset_summary::read_from(state, pos, instance_information);
+    }
+    return tree;
+}
+
+void trans_tree::wake() {
+    if (!is_hibernated()) {
+        return;
+    }
+
+    const string& state = hibernated_state;
+    size_t pos = 0;
+
+    int block_size = read_value<int>(state, pos);
+    std::map<long, shared_ptr<column_block>> block_table;
+    int num_blocks = read_value<int>(state, pos);
+    for (int i = 0; i < num_blocks; i++) {
+        long block_idx = read_value<long>(state, pos);
+        block_table[block_idx] = column_block::read_from(state, pos, block_size);
+    }
+
+    int num_trees = read_value<int>(state, pos);
+    int num_spilled_stores = 0;
+    for (int i = 0; i < num_trees; i++) {
+        tree_pool.push_back(read_hibernated_tree(state, pos, block_table, block_size, num_spilled_stores));
+    }
+    foreground_tree = tree_pool[read_value<int>(state, pos)];
+    if (read_value<bool>(state, pos)) {
+        foreground_tree->bg_tree = read_hibernated_tree(state, pos, block_table, block_size, num_spilled_stores);
+    }
+    foreground_tree->warning_detector = std::move(hibernated_warning_detector);
+    foreground_tree->drift_detector = std::move(hibernated_drift_detector);
+
+    int num_actual_labels = read_value<int>(state, pos);
+    for (int i = 0; i < num_actual_labels; i++) {
+        actual_labels.push_back(read_value<int>(state, pos));
+    }
+    int num_predicted_labels = read_value<int>(state, pos);
+    for (int i = 0; i < num_predicted_labels; i++) {
+        foreground_tree->predicted_labels.push_back(read_value<int>(state, pos));
+    }
+
+    hibernated_state.clear();
+    hibernated_state.shrink_to_fit();
+    hibernated_spilled_stores.clear();
+}
+
+bool trans_tree::is_hibernated() const {
+    return !hibernated_state.empty();
+}
+
+// approximate resident size, instances held by warning windows are counted once
+long trans_tree::get_memory_estimate() {
+    if (is_hibernated()) {
+        return sizeof(trans_tree)
+               + hibernated_state.capacity()
+               + hibernated_spilled_stores.capacity() * sizeof(columnar_store);
+    }
+
+    set<const void*> counted;
+    long bytes = sizeof(trans_tree)
+                 + tree_pool.capacity() * sizeof(shared_ptr<hoeffding_tree>)
+                 + actual_labels.size() * sizeof(int);
+
+    for (auto& tree : tree_pool) {
+        bytes += tree->get_memory_estimate(counted);
+    }
+    if (bbt_pool != nullptr) {
+        bytes += bbt_pool->get_memory_estimate(counted);
+    }
+    bytes += retained_log.get_memory_bytes(counted);
+    if (discretizer != nullptr) {
+        bytes += discretizer->get_memory_bytes();
+    }
+
+    return bytes;
+}
+
 int trans_tree::get_transferred_tree_group_size() {
     return transferred_tree_total_count;
 }
 
 int trans_tree::get_tree_pool_size() {
-    return tree_pool.size();
+    return tree_pool_size;
 }
 
 bool trans_tree::detect_change(int error_count, unique_ptr<HT::ADWIN>& detector) {
@@ -355,11 +939,27 @@ bool trans_tree::init_data_source(const string& filename) {
 }
 
 bool trans_tree::get_next_instance() {
-    if (!reader->hasNextInstance()) {
+    if (discretizer != nullptr && !discretizer->is_frozen()) {
+        while (!discretizer->is_frozen() && reader->hasNextInstance()) {
+            warmup_instances.emplace_back(reader->nextInstance());
+            discretizer->observe(*warmup_instances.back());
+        }
+        discretizer->freeze();
+    }
+
+    if (!warmup_instances.empty()) {
+        instance = arena.adopt(warmup_instances.front().release());
+        warmup_instances.pop_front();
+    } else if (reader->hasNextInstance()) {
+        instance = arena.adopt(reader->nextInstance());
+    } else {
         return false;
     }
 
-    instance = reader->nextInstance();
+    if (discretizer != nullptr) {
+        // the arena only holds dense instances
+        discretizer->discretize(static_cast<DenseInstance&>(*instance));
+    }
     return true;
 }
 
@@ -367,8 +967,10 @@ int trans_tree::get_cur_instance_label() {
     return instance->getLabel();
 }
 
+// drops the learner's reference, the instance is reclaimed with its slab
+// once no store or warning window holds it
 void trans_tree::delete_cur_instance() {
-    delete instance;
+    instance = nullptr;
 }
 
 
@@ -391,22 +993,38 @@ hoeffding_tree::hoeffding_tree(hoeffding_tree const &rhs) :
             drift_delta(rhs.drift_delta),
             instance_store_size(rhs.instance_store_size) {
 
-    tree = make_unique<HT::HoeffdingTree>();
+    if (rhs.instance_summary != nullptr) {
+        instance_summary = make_shared<coreset_summary>(rhs.instance_summary->get_max_size());
+    }
+    if (rhs.compact_tree != nullptr) {
+        compact_tree = rhs.compact_tree->clone_settings();
+    } else {
+        tree = make_unique<HT::HoeffdingTree>();
+    }
     warning_detector = make_unique<HT::ADWIN>(warning_delta);
     drift_detector = make_unique<HT::ADWIN>(drift_delta);
     bg_tree = nullptr;
 }
 
+void hoeffding_tree::use_compact_tree() {
+    tree = nullptr;
+    compact_tree = make_unique<compact_hoeffding_tree>();
+}
+
 int hoeffding_tree::predict(Instance& instance, bool track_prediction) {
-    double* classPredictions = tree->getPrediction(instance);
     int result = 0;
-    double max_val = classPredictions[0];
-
-    // Find class label with the highest probability
-    for (int i = 1; i < instance.getNumberClasses(); i++) {
-        if (max_val < classPredictions[i]) {
-            max_val = classPredictions[i];
-            result = i;
+    if (compact_tree != nullptr) {
+        result = compact_tree->predict(instance);
+    } else {
+        double* classPredictions = tree->getPrediction(instance);
+        double max_val = classPredictions[0];
+
+        // Find class label with the highest probability
+        for (int i = 1; i < instance.getNumberClasses(); i++) {
+            if (max_val < classPredictions[i]) {
+                max_val = classPredictions[i];
+                result = i;
+            }
         }
     }
 
@@ -420,31 +1038,103 @@ int hoeffding_tree::predict(Instance& instance, bool track_prediction) {
     return result;
 }
 
-void hoeffding_tree::train(Instance& instance) {
-    tree->train(instance);
+void hoeffding_tree::train(const Instance& instance, double weight, bool train_bg_tree) {
+    if (compact_tree != nullptr) {
+        compact_tree->train(instance, weight);
+    } else {
+        train_weighted(*tree, instance, weight);
+        trained_weight += std::max(weight, 0.0);
+    }
 
-    if (bg_tree != nullptr) {
-        bg_tree->train(instance);
+    if (bg_tree != nullptr && train_bg_tree) {
+        bg_tree->train(instance, weight);
     }
 }
 
-void hoeffding_tree::store_instance(Instance* instance) {
-    if (instance == nullptr) {
-        cout << "nullptr instance added! " << endl;
-        exit(1);
+void hoeffding_tree::train_batch(const vector<const Instance*>& instances,
+                                 const vector<double>& weights,
+                                 bool train_bg_tree) {
+    if (compact_tree != nullptr) {
+        compact_tree->train_batch(instances, weights);
+    } else {
+        for (int i = 0; i < instances.size(); i++) {
+            train_weighted(*tree, *instances[i], weights[i]);
+            trained_weight += std::max(weights[i], 0.0);
+        }
+    }
+
+    if (bg_tree != nullptr && train_bg_tree) {
+        bg_tree->train_batch(instances, weights);
     }
+}
 
-    if (this->instance_store.size() < this->instance_store_size) {
-        this->instance_store.push_back(instance);
-        // this->instance_store.pop_front();
+long hoeffding_tree::get_model_bytes() {
+    if (compact_tree != nullptr) {
+        return compact_tree->get_live_bytes();
     }
+    return get_streamdm_bytes();
+}
 
-    if (this->bg_tree != nullptr) {
-        if (bg_tree->instance_store.size() < this->instance_store_size) {
-            bg_tree->instance_store.push_back(instance);
-            // trans_bg_tree->instance_store.pop_front();
-        }
+long hoeffding_tree::get_streamdm_bytes() {
+    if (streamdm_bytes < 0 || trained_weight - streamdm_bytes_weight >= streamdm_bytes_refresh_weight) {
+        streamdm_bytes = serialize_tree(*tree).size();
+        streamdm_bytes_weight = trained_weight;
     }
+    return streamdm_bytes;
+}
+
+void hoeffding_tree::count_split_attempts(long& attempts, long& saved) {
+    if (compact_tree != nullptr) {
+        attempts += compact_tree->get_num_split_attempts();
+        saved += compact_tree->get_num_split_attempts_saved();
+    }
+}
+
+bool hoeffding_tree::has_room() const {
+    if (instance_summary != nullptr) {
+        return instance_summary->get_absorbed_count() < instance_store_size;
+    }
+    return instance_store.size() < instance_store_size;
+}
+
+bool hoeffding_tree::is_storing() const {
+    return has_room() || (bg_tree != nullptr && bg_tree->has_room());
+}
+
+void hoeffding_tree::store_instance(Instance& instance, instance_log& log) {
+    long row = -1;
+    if (has_room()) {
+        retain(instance, log, row);
+    }
+    if (bg_tree != nullptr && bg_tree->has_room()) {
+        bg_tree->retain(instance, log, row);
+    }
+}
+
+void hoeffding_tree::retain(Instance& instance, instance_log& log, long& row) {
+    if (instance_summary != nullptr) {
+        instance_summary->add(instance);
+        return;
+    }
+    if (row == -1) {
+        row = log.append(instance);
+    }
+    instance_store.append(log, row);
+}
+
+long hoeffding_tree::get_memory_estimate(set<const void*>& counted) {
+    long bytes = sizeof(hoeffding_tree)
+                 + 2 * sizeof(HT::ADWIN)
+                 + (compact_tree != nullptr ? compact_tree->get_memory_bytes() : get_streamdm_bytes())
+                 + instance_store.get_memory_bytes(counted)
+                 + (instance_summary != nullptr ? instance_summary->get_memory_bytes() : 0)
+                 + predicted_labels.size() * sizeof(int);
+
+    if (bg_tree != nullptr) {
+        bytes += bg_tree->get_memory_estimate(counted);
+    }
+
+    return bytes;
 }
 
 // class boosted_bg_tree_pool
@@ -454,15 +1144,27 @@ trans_tree::boosted_bg_tree_pool::boosted_bg_tree_pool(
         int eviction_interval,
         double transfer_kappa_threshold,
         shared_ptr<hoeffding_tree> tree_template,
-        int lambda):
+        int lambda,
+        splittable_rng mrand,
+        drift_detector_enum drift_detector,
+        double drift_delta,
+        bool share_root_observations):
         boost_mode(boost_mode),
         eviction_interval(eviction_interval),
         transfer_kappa_threshold(transfer_kappa_threshold),
         pool_size(pool_size),
         tree_template(tree_template),
-        lambda(lambda) {
-
-    mrand = std::mt19937(42);
+        lambda(lambda),
+        mrand(mrand),
+        drift_detectors(drift_detector, pool_size, drift_delta) {
+
+    // a single member has nothing to share with
+    if (share_root_observations
+        && boost_mode != boost_modes_enum::no_boost_mode
+        && tree_template->compact_tree != nullptr
+        && tree_template->compact_tree->get_num_nodes() == 0) {
+        shared_observations = make_shared<shared_observation_log>();
+    }
 
     for (int i = 0; i < pool_size; i++) {
         oob_tree_lam_sum.push_back(0);
@@ -503,49 +1205,143 @@ void trans_tree::boosted_bg_tree_pool::online_boost(Instance *instance,
         }
     }
 
+    if (shared_observations != nullptr) {
+        shared_observations->append(*instance);
+    }
+
+    // a summarized source instance stands for as many raw ones as its weight
+    double lambda_d = is_same_distribution ? 1 : instance->getWeight();
+
     switch(boost_mode) {
         case boost_modes_enum::no_boost_mode:
-            this->no_boost(instance);
+            this->no_boost(instance, lambda_d);
             break;
         case boost_modes_enum::ozaboost_mode:
-            this->ozaboost(instance);
+            this->ozaboost(instance, lambda_d);
             break;
         case boost_modes_enum::tradaboost_mode:
-            this->tradaboost(instance, is_same_distribution);
+            this->tradaboost(instance, is_same_distribution, lambda_d);
             break;
         case boost_modes_enum::otradaboost_mode:
-            this->otradaboost(instance, is_same_distribution);
+            this->otradaboost(instance, is_same_distribution, lambda_d);
             break;
         case boost_modes_enum::atradaboost_mode:
-            this->atradaboost(instance, is_same_distribution);
+            this->atradaboost(instance, is_same_distribution, lambda_d);
             break;
         default:
             cout << "Incorrect boost_mode" << endl;
             exit(1);
     }
 
-    if (is_same_distribution) {
+    if (is_same_distribution && enable_perf_eval) {
         this->perf_eval(instance);
     }
 }
 
 Instance* trans_tree::boosted_bg_tree_pool::get_next_diff_distr_instance() {
-    if (instance_store_idx >= matched_tree->instance_store.size()) {
+    if (!materialize_next_diff_distr_instance(replay_instance)) {
         return nullptr;
     }
-    return matched_tree->instance_store[instance_store_idx++];
+    return &replay_instance;
+}
+
+bool trans_tree::boosted_bg_tree_pool::materialize_next_diff_distr_instance(DenseInstance& instance) {
+    if (replay_summary != nullptr) {
+        if (instance_store_idx >= replay_summary->size()) {
+            return false;
+        }
+        replay_summary->materialize(instance_store_idx++, instance);
+        return true;
+    }
+
+    if (instance_store_idx >= replay_store.size()) {
+        return false;
+    }
+    replay_store.materialize(instance_store_idx++, instance);
+    return true;
 }
 
+// what online_boost does with a source instance in no_boost mode
+void trans_tree::boosted_bg_tree_pool::replay_batch(int num_instances, int batch_size) {
+    if (boost_mode != boost_modes_enum::no_boost_mode) {
+        cout << "replay_batch(): only supported in no_boost mode" << endl;
+        exit(1);
+    }
+
+    replay_batch_instances.resize(batch_size);
+    vector<const Instance*> batch;
+    vector<double> weights;
+    bool exhausted = false;
+    while (num_instances > 0 && !exhausted) {
+        batch.clear();
+        weights.clear();
+        while (batch.size() < batch_size && num_instances > 0) {
+            DenseInstance& instance = replay_batch_instances[batch.size()];
+            if (!materialize_next_diff_distr_instance(instance)) {
+                exhausted = true;
+                break;
+            }
+            num_instances--;
+            batch.push_back(&instance);
+            weights.push_back(instance.getWeight());
+        }
+        if (!batch.empty()) {
+            pool[0]->train_batch(batch, weights);
+        }
+    }
+}
+
+long trans_tree::boosted_bg_tree_pool::get_memory_estimate(set<const void*>& counted) {
+    long bytes = sizeof(boosted_bg_tree_pool)
+                 + warning_period_instances.capacity() * sizeof(shared_ptr<Instance>)
+                 + 10 * pool_size * sizeof(double);
+    for (auto& warning_period_instance : warning_period_instances) {
+        if (counted.insert(warning_period_instance.get()).second) {
+            bytes += sizeof(DenseInstance)
+                     + (warning_period_instance->getNumberInputAttributes() + 1) * sizeof(double);
+        }
+    }
+
+    for (auto& tree : pool) {
+        bytes += tree->get_memory_estimate(counted);
+    }
+    bytes += drift_detectors.get_memory_bytes() - sizeof(drift_detector_bank);
+    if (shared_observations != nullptr) {
+        bytes += shared_observations->get_memory_bytes();
+    }
+    bytes += replay_store.get_memory_bytes(counted);
+    if (replay_summary != nullptr) {
+        bytes += replay_summary->get_memory_bytes();
+    }
+
+    return bytes;
+}
+
+void trans_tree::boosted_bg_tree_pool::collect_model_bytes(vector<long>& model_bytes) {
+    for (auto& tree : pool) {
+        model_bytes.push_back(tree->get_model_bytes());
+    }
+}
+
+void trans_tree::boosted_bg_tree_pool::count_split_attempts(long& attempts, long& saved) {
+    for (auto& tree : pool) {
+        tree->count_split_attempts(attempts, saved);
+    }
+}
+
+// warnings have no effect on pool members and are not detected, members' own
+// detectors are seeded on transfer (see seed_detectors)
 void trans_tree::boosted_bg_tree_pool::perf_eval(Instance* instance) {
+    pool_errors.resize(pool.size());
     for (int i = 0; i < pool.size(); i++) {
-        auto tree = pool[i];
-        int predicted_label = tree->predict(*instance, true);
-        int error_count = (int) (predicted_label != instance->getLabel());
-        if (trans_tree::detect_change(error_count, tree->drift_detector)) {
-            pool[i] = std::make_shared<hoeffding_tree>(*tree_template);
-        }
-        if (trans_tree::detect_change(error_count, tree->warning_detector)) {
-            // do nothing
+        int predicted_label = pool[i]->predict(*instance, true);
+        pool_errors[i] = predicted_label != instance->getLabel();
+    }
+
+    drift_detectors.update(pool_errors, pool.size(), pool_drifts);
+    for (int i = 0; i < pool.size(); i++) {
+        if (pool_drifts[i]) {
+            replace_tree(i, make_member());
         }
     }
 }
@@ -572,27 +1368,40 @@ shared_ptr<hoeffding_tree> trans_tree::boosted_bg_tree_pool::get_best_model(dequ
     return best_model;
 }
 
+shared_ptr<hoeffding_tree> trans_tree::boosted_bg_tree_pool::make_member() {
+    shared_ptr<hoeffding_tree> new_tree = std::make_shared<hoeffding_tree>(*tree_template);
+    if (shared_observations != nullptr) {
+        new_tree->compact_tree->share_root(shared_observations);
+    }
+    return new_tree;
+}
+
 void trans_tree::boosted_bg_tree_pool::update_bbt() {
     bbt_counter++;
 
     // create a new boosting tree for current mini-batch
-    shared_ptr<hoeffding_tree> new_tree = std::make_shared<hoeffding_tree>(*tree_template);
+    shared_ptr<hoeffding_tree> new_tree = make_member();
     if (pool.size() < pool_size) {
         pool.push_back(new_tree);
     } else {
-        pool[bbt_counter % pool_size] = new_tree;
+        replace_tree(bbt_counter % pool_size, new_tree);
     }
 }
 
-void trans_tree::boosted_bg_tree_pool::no_boost(Instance* instance) {
+void trans_tree::boosted_bg_tree_pool::replace_tree(int idx, shared_ptr<hoeffding_tree> new_tree) {
+    if (reclaimer != nullptr) {
+        reclaimer->retire(std::move(pool[idx]));
+    }
+    pool[idx] = std::move(new_tree);
+    drift_detectors.reset(idx);
+}
+
+void trans_tree::boosted_bg_tree_pool::no_boost(Instance* instance, double lambda_d) {
     // Only one tree exists in no_boost_mode
-    instance->setWeight(1);
-    pool[0]->train(*instance);
+    pool[0]->train(*instance, lambda_d);
 }
 
-void trans_tree::boosted_bg_tree_pool::ozaboost(Instance* instance) {
-    double lambda_d = 1;
-    instance->setWeight(1);
+void trans_tree::boosted_bg_tree_pool::ozaboost(Instance* instance, double lambda_d) {
 
     // vector<double> lambda_vals;
 
@@ -603,13 +1412,9 @@ void trans_tree::boosted_bg_tree_pool::ozaboost(Instance* instance) {
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
 
-        double weight = instance->getWeight();
         // oob_tree_lam_sum[i] += k*weight;
-        if (k > 0 && weight > 0) {
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+        if (k > 0) {
+            tree->train(*instance, k);
         }
 
         oob_tree_lam_sum[i] += lambda_d;
@@ -641,9 +1446,9 @@ void trans_tree::boosted_bg_tree_pool::ozaboost(Instance* instance) {
     // cout << endl;
 }
 
-void trans_tree::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_same_distribution) {
-    double lambda_d = 1;
-    instance->setWeight(1);
+void trans_tree::boosted_bg_tree_pool::tradaboost(Instance* instance,
+                                                  bool is_same_distribution,
+                                                  double lambda_d) {
     if (!is_same_distribution) {
         num_src_instances += 1;
     }
@@ -658,11 +1463,7 @@ void trans_tree::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_sa
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
         if (k > 0) {
-            double weight = instance->getWeight();
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+            tree->train(*instance, k);
         }
 
         if (is_same_distribution) {
@@ -701,9 +1502,9 @@ void trans_tree::boosted_bg_tree_pool::tradaboost(Instance* instance, bool is_sa
     }
 }
 
-void trans_tree::boosted_bg_tree_pool::otradaboost(Instance* instance, bool is_same_distribution) {
-    double lambda_d = 1;
-    instance->setWeight(1);
+void trans_tree::boosted_bg_tree_pool::otradaboost(Instance* instance,
+                                                   bool is_same_distribution,
+                                                   double lambda_d) {
     if (!is_same_distribution) {
         num_src_instances += 1;
     }
@@ -718,11 +1519,7 @@ void trans_tree::boosted_bg_tree_pool::otradaboost(Instance* instance, bool is_s
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
         if (k > 0) {
-            double weight = instance->getWeight();
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+            tree->train(*instance, k);
         }
 
         if (k == 0) {
@@ -765,9 +1562,9 @@ void trans_tree::boosted_bg_tree_pool::otradaboost(Instance* instance, bool is_s
     }
 }
 
-void trans_tree::boosted_bg_tree_pool::atradaboost(Instance* instance, bool is_same_distribution) {
-    double lambda_d = 1;
-    instance->setWeight(1);
+void trans_tree::boosted_bg_tree_pool::atradaboost(Instance* instance,
+                                                   bool is_same_distribution,
+                                                   double lambda_d) {
     if (!is_same_distribution) {
         num_src_instances += 1;
         // lambda_d *= weight_factor;
@@ -783,11 +1580,7 @@ void trans_tree::boosted_bg_tree_pool::atradaboost(Instance* instance, bool is_s
         std::poisson_distribution<int> poisson_distr(lambda_d);
         double k = poisson_distr(mrand);
         if (k > 0) {
-            double weight = instance->getWeight();
-            instance->setWeight(k * weight);
-
-            tree->train(*instance);
-            instance->setWeight(weight);
+            tree->train(*instance, k);
         }
 
         if (is_same_distribution) {
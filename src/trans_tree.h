@@ -1,10 +1,25 @@
 #ifndef TRANS_TREE_H
 #define TRANS_TREE_H
 
+#include <atomic>
+
 #include <streamDM/streams/ArffReader.h>
 #include <streamDM/learners/Classifiers/Trees/HoeffdingTree.h>
 #include <streamDM/learners/Classifiers/Trees/ADWIN.h>
 
+#include "model_snapshot.h"
+#include "training_queue.h"
+#include "load_shedder.h"
+#include "weighted_training.h"
+#include "instance_arena.h"
+#include "columnar_store.h"
+#include "coreset_summary.h"
+#include "deferred_reclaimer.h"
+#include "splittable_rng.h"
+#include "drift_detector_bank.h"
+#include "shared_observation_log.h"
+#include "quantile_discretizer.h"
+
 enum class boost_modes_enum { no_boost_mode, ozaboost_mode, tradaboost_mode, otradaboost_mode, atradaboost_mode };
 double compute_kappa(deque<int> predicted_labels, deque<int> actual_labels, int class_count);
 
@@ -28,11 +43,15 @@ public:
             double gamma,
             double transfer_match_lowerbound,
             string boost_mode_str);
+    ~trans_tree();
 
     void train();
+    void train_instance(shared_ptr<Instance> instance);
     int predict();
+    int predict_instance(Instance* instance);
     void init();
     shared_ptr<hoeffding_tree> make_tree(int tree_pool_id);
+    unique_ptr<boosted_bg_tree_pool> make_bbt_pool(shared_ptr<hoeffding_tree> tree_template);
     static bool detect_change(int error_count, unique_ptr<HT::ADWIN>& detector);
 
     int get_transferred_tree_group_size();
@@ -43,13 +62,111 @@ public:
     int get_cur_instance_label();
     void delete_cur_instance();
 
+    // serving: lock-free predictions from a periodically refreshed copy of the foreground tree
+    void set_snapshot_staleness(int max_instances, int max_millis);
+    void publish_snapshot();
+    int predict_snapshot();
+    int predict_snapshot(Instance& instance);
+
+    // decoupled training: train() only enqueues, a background thread owns the learner
+    void enable_async_training(int queue_capacity, string overflow_policy);
+    void flush_training_queue();
+    vector<long> get_training_queue_stats();
+
+    // adaptive load shedding when training falls behind the target rate
+    void set_load_shedding(double target_rate);
+    vector<long> get_load_shedding_stats();
+
+    // float64, float32, uint16 or uint8 columns for instances retained afterwards
+    void set_instance_store_encoding(string encoding_str);
+
+    // out of core: while the learner's estimated size exceeds threshold_bytes,
+    // the instance stores of archived trees are spilled to disk, oldest first
+    // (<= 0 disables). They are read back when a tree is matched for replay.
+    void set_spill_threshold(long threshold_bytes);
+    // spilled stores, bytes held in the process spill file, and bytes of
+    // released extents the file system did not free
+    vector<long> get_spill_stats();
+
+    // replay summaries: trees created afterwards keep a weighted coreset of at
+    // most max_representatives instead of their raw instances (0 keeps raw)
+    void set_instance_summary_size(int max_representatives);
+
+    // "streamdm" or "compact": trees created afterwards use streamDM's tree or
+    // a compact_hoeffding_tree whose nodes and leaf statistics sit in one arena
+    void set_tree_backend(string backend_str);
+
+    // discarded trees and transfer pools are destroyed by the process-wide
+    // deferred_reclaimer instead of inside train()
+    void set_deferred_reclamation(bool enabled);
+    // process-wide: objects retired, objects waiting to be released
+    vector<long> get_reclamation_stats();
+
+    // adwin, ddm, eddm or hddm_a: drift detection of transfer pool members,
+    // batched over the pool, applies to pools created afterwards
+    void set_pool_drift_detector(string detector_str);
+
+    // compact trees only: bytes each tree may keep alive, and bytes split
+    // evenly among the members of a transfer pool (0: unlimited). Applies to
+    // trees created afterwards. Arena space held for recycling is not counted.
+    void set_memory_budget(long tree_bytes, long pool_bytes);
+    // model size of each archived tree, then of each transfer pool member
+    vector<long> get_tree_model_bytes();
+
+    // compact trees only: transfer pool members record each instance's
+    // attribute values once in a shared log until their root splits
+    void set_shared_pool_observations(bool enabled);
+
+    // instances are discretized into quantile bins as they are read (nullptr
+    // disables); compact trees observe them through histograms. Learners
+    // that transfer trees must share one discretizer.
+    void set_discretizer(shared_ptr<quantile_discretizer> discretizer);
+
+    // process-wide kernel of the compact trees' Gaussian observer updates:
+    // auto, scalar or avx2
+    void set_observer_isa(string isa_str);
+
+    // compact trees only, see compact_hoeffding_tree::set_adaptive_grace_period
+    void set_adaptive_grace_period(bool enabled);
+    // split attempts made and saved by the live trees: archived, background
+    // and transfer pool members
+    vector<long> get_split_attempt_stats();
+
+    // compact trees only: split attempts are evaluated on num_workers threads
+    // shared by all trees of this learner (0: inline)
+    void set_split_workers(int num_workers);
+    // evaluations submitted, and those the training thread ran itself
+    // because no worker had picked them up when the tree needed them
+    vector<long> get_split_scheduler_stats();
+
+    // compact trees only: leaves observing at least min_attributes attributes
+    // partition them across num_workers threads plus the training thread (0: off)
+    void set_attribute_workers(int num_workers, int min_attributes);
+
+    // no_boost pools replay source instances in batches of batch_size (0:
+    // one at a time), see hoeffding_tree::train_batch. Boosting modes replay
+    // one at a time, a member's weights follow the previous members'
+    // predictions and the shared Poisson draws.
+    void set_replay_batch_size(int batch_size);
+
+    // hosting: an idle learner is packed into a compact buffer and unpacked on
+    // its next use. The archived trees and the foreground's background tree
+    // are serialized; the foreground's drift and warning detectors and an
+    // untrained transfer pool stay resident. Returns false, leaving the
+    // learner as it is, while a transfer is in progress.
+    bool hibernate();
+    void wake();
+    bool is_hibernated() const;
+    long get_memory_estimate();
+
     // transfer
     vector<shared_ptr<hoeffding_tree>>& get_concept_repo();
     void register_tree_pool(vector<shared_ptr<hoeffding_tree>>& pool);
-    bool transfer(Instance* instance);
-    shared_ptr<hoeffding_tree> match_concept(vector<Instance*> warning_period_instances);
+    bool transfer(const shared_ptr<Instance>& instance);
+    shared_ptr<hoeffding_tree> match_concept(const vector<shared_ptr<Instance>>& warning_period_instances);
     int get_transferred_tree_group_size() const;
-    int transferred_tree_total_count = 0;
+    // read by the caller while the async training thread transfers
+    std::atomic<int> transferred_tree_total_count{0};
     // double compute_kappa(vector<int> predicted_labels, vector<int> actual_labels, int class_count);
     vector<vector<shared_ptr<hoeffding_tree>>*> registered_tree_pools;
 
@@ -61,15 +178,67 @@ private:
     int kappa_window_size;
     double warning_delta;
     double drift_delta;
-    std::mt19937 mrand;
+    // each transfer pool gets its own stream split off this one
+    splittable_rng mrand;
     shared_ptr<hoeffding_tree> foreground_tree;
     vector<shared_ptr<hoeffding_tree>> tree_pool;
+    // mirrors tree_pool.size(), which is not safe to read while the async training thread appends
+    std::atomic<int> tree_pool_size{0};
     deque<int> actual_labels;
 
-    Instance* instance;
+    shared_ptr<Instance> instance;
     unique_ptr<Reader> reader;
+    instance_arena arena;
+    // read ahead while the discretizer's cut points are fit
+    deque<unique_ptr<Instance>> warmup_instances;
+
+    // serving
+    long num_instances_trained = 0;
+    snapshot_policy snapshot_refresh;
+    rcu_cell<model_snapshot> snapshot;
+    unique_ptr<training_queue> async_training;
+    load_shedder load_shedding;
+
+    // hosting
+    string hibernated_state;
+    unique_ptr<HT::ADWIN> hibernated_warning_detector;
+    unique_ptr<HT::ADWIN> hibernated_drift_detector;
+    void write_hibernated_tree(string& state, hoeffding_tree& tree);
+    shared_ptr<hoeffding_tree> read_hibernated_tree(const string& state,
+                                                    size_t& pos,
+                                                    std::map<long, shared_ptr<column_block>>& block_table,
+                                                    int block_size,
+                                                    int& num_spilled_stores);
+    InstanceInformation* instance_information = nullptr;
+
+    // rows kept by the trees' instance stores, appended once per instance
+    instance_log retained_log;
+
+    // out of core
+    long spill_threshold = 0;
+    // spilled stores stay on disk while the learner hibernates
+    vector<columnar_store> hibernated_spilled_stores;
+    void spill_archived_stores();
+
+    int instance_summary_size = 0;
+    bool use_compact_trees = false;
+    drift_detector_enum pool_drift_detector = drift_detector_enum::adwin_detector;
+    long tree_memory_budget = 0;
+    long pool_memory_budget = 0;
+    bool share_pool_observations = false;
+    shared_ptr<quantile_discretizer> discretizer;
+    bool adaptive_grace_period = false;
+    shared_ptr<split_scheduler> split_workers;
+    shared_ptr<attribute_workers> vertical_workers;
+    int min_parallel_attributes = 0;
+    int replay_batch_size = 0;
+
+    // null: discarded state is destroyed in place
+    deferred_reclaimer* reclaimer = nullptr;
+    void retire_bbt_pool();
 
     // transfer
+    void seed_detectors(hoeffding_tree& tree);
     std::map<string, boost_modes_enum> boost_mode_map =
             {
                     { "no_boost", boost_modes_enum::no_boost_mode},
@@ -91,23 +260,42 @@ private:
     public:
         boost_modes_enum boost_mode = boost_modes_enum::otradaboost_mode;
         double weight_factor = 1.0;
+        bool enable_perf_eval = true;
+        deferred_reclaimer* reclaimer = nullptr;
 
         boosted_bg_tree_pool(enum boost_modes_enum boost_mode,
                              int pool_size,
                              int eviction_interval,
                              double transfer_kappa_threshold,
                              shared_ptr<hoeffding_tree> tree_template,
-                             int lambda);
+                             int lambda,
+                             splittable_rng mrand,
+                             drift_detector_enum drift_detector,
+                             double drift_delta,
+                             bool share_root_observations);
 
         // training starts when a mini_batch is ready
         void train(Instance* instance, bool is_same_distribution);
         shared_ptr<hoeffding_tree> get_best_model(deque<int> actual_labels, int class_count);
         void online_boost(Instance* instance, bool _is_same_distribution);
         Instance* get_next_diff_distr_instance();
-
-        vector<Instance*> warning_period_instances;
+        // trains pool[0] on the next num_instances replayed source instances,
+        // no_boost only
+        void replay_batch(int num_instances, int batch_size);
+        long get_memory_estimate(set<const void*>& counted);
+        void collect_model_bytes(vector<long>& model_bytes);
+        void count_split_attempts(long& attempts, long& saved);
+
+        vector<shared_ptr<Instance>> warning_period_instances;
         shared_ptr<hoeffding_tree> matched_tree = nullptr;
+        // resident copy of the matched tree's store, read back if it was spilled
+        columnar_store replay_store;
+        // copy of the matched tree's summary, replayed instead of the store
+        unique_ptr<coreset_summary> replay_summary;
         int instance_store_idx = 0;
+        // replayed source rows are materialized here
+        DenseInstance replay_instance;
+        vector<DenseInstance> replay_batch_instances;
 
         vector<double> oob_tree_correct_lam_sum; // count of out-of-bag correctly predicted trees per instance
         vector<double> oob_tree_wrong_lam_sum; // count of out-of-bag incorrectly predicted trees per instance
@@ -130,7 +318,7 @@ private:
     private:
         double lambda = 1;
         double epsilon = 1;
-        std::mt19937 mrand;
+        splittable_rng mrand;
 
         long pool_size = 10;
         long bbt_counter = 0;
@@ -139,14 +327,29 @@ private:
         double transfer_kappa_threshold = 0.3;
         shared_ptr<hoeffding_tree> tree_template;
         vector<shared_ptr<hoeffding_tree>> pool;
-
+        // rows for members with unsplit compact roots, null if they keep
+        // their own observers
+        shared_ptr<shared_observation_log> shared_observations;
+        // member i watches pool[i], the trees' own detectors are not fed
+        drift_detector_bank drift_detectors;
+        vector<uint8_t> pool_errors;
+        vector<uint8_t> pool_drifts;
+
+        // false once the source instances are used up
+        bool materialize_next_diff_distr_instance(DenseInstance& instance);
+        // copy of tree_template, sharing its root observations if enabled
+        shared_ptr<hoeffding_tree> make_member();
         // execute replacement strategies when the bbt pool is full
         void update_bbt();
-        void no_boost(Instance* instance);
-        void ozaboost(Instance* instance);
-        void tradaboost(Instance* instance, bool is_same_distribution);
-        void otradaboost(Instance* instance, bool is_same_distribution);
-        void atradaboost(Instance* instance, bool is_same_distribution);
+        // the replaced tree is retired to the reclaimer if one is set, its
+        // detector starts over
+        void replace_tree(int idx, shared_ptr<hoeffding_tree> new_tree);
+        // lambda_d starts at the instance's replay weight
+        void no_boost(Instance* instance, double lambda_d);
+        void ozaboost(Instance* instance, double lambda_d);
+        void tradaboost(Instance* instance, bool is_same_distribution, double lambda_d);
+        void otradaboost(Instance* instance, bool is_same_distribution, double lambda_d);
+        void atradaboost(Instance* instance, bool is_same_distribution, double lambda_d);
         void perf_eval(Instance* instance);
     };
 };
@@ -156,11 +359,29 @@ public:
     hoeffding_tree(double warning_delta, double drift_delta, int instance_store_size);
     hoeffding_tree(hoeffding_tree const &rhs);
 
-    void train(Instance& instance);
+    // instances are read-only once ingested, the training weight is passed per call
+    void train(const Instance& instance, double weight, bool train_bg_tree = true);
+    // same trees as train on each instance in turn, compact trees route the
+    // batch once and train it leaf by leaf
+    void train_batch(const vector<const Instance*>& instances,
+                     const vector<double>& weights,
+                     bool train_bg_tree = true);
     int predict(Instance& instance, bool track_prediction);
-    void store_instance(Instance* instance);
+    // true while this tree or its background tree still has room
+    bool is_storing() const;
+    // appends to the log at most once, the summary keeps its own copy
+    void store_instance(Instance& instance, instance_log& log);
+    long get_memory_estimate(set<const void*>& counted);
+    // swaps the untrained streamDM tree for a compact_hoeffding_tree
+    void use_compact_tree();
+    // the tree itself, without instance stores and detectors
+    long get_model_bytes();
+    // adds the compact tree's counters, streamDM trees have none
+    void count_split_attempts(long& attempts, long& saved);
 
     unique_ptr<HT::HoeffdingTree> tree;
+    // replaces tree when set
+    unique_ptr<compact_hoeffding_tree> compact_tree;
     shared_ptr<hoeffding_tree> bg_tree;
     unique_ptr<HT::ADWIN> warning_detector;
     unique_ptr<HT::ADWIN> drift_detector;
@@ -169,7 +390,9 @@ public:
     deque<int> predicted_labels;
     int kappa_window_size = 60;
 
-    deque<Instance*> instance_store;
+    columnar_store instance_store;
+    // replaces instance_store when set
+    shared_ptr<coreset_summary> instance_summary;
     int instance_store_size;
     double warning_period_kappa = std::numeric_limits<double>::min();
 
@@ -177,6 +400,17 @@ private:
     double warning_delta;
     double drift_delta;
 
+    // a streamDM tree is measured by serializing it; the size is reused
+    // until the tree has been trained on streamdm_bytes_refresh_weight more
+    // weight, so archived trees, which are no longer trained, are measured once
+    static const int streamdm_bytes_refresh_weight = 1000;
+    double trained_weight = 0;
+    double streamdm_bytes_weight = 0;
+    long streamdm_bytes = -1;
+
+    bool has_room() const;
+    void retain(Instance& instance, instance_log& log, long& row);
+    long get_streamdm_bytes();
 };
 
 #endif //TRANS_TREE_H
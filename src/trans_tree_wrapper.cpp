@@ -45,6 +45,10 @@ trans_tree_wrapper::trans_tree_wrapper(
 }
 
 void trans_tree_wrapper::switch_classifier(int classifier_idx){
+    if (current_classifier != nullptr) {
+        // other streams read this classifier's concept repo
+        current_classifier->flush_training_queue();
+    }
     current_classifier = classifiers[classifier_idx];
 }
 
@@ -75,3 +79,143 @@ int trans_tree_wrapper::get_transferred_tree_group_size() {
 int trans_tree_wrapper::get_tree_pool_size() {
     return current_classifier->get_tree_pool_size();
 }
+
+void trans_tree_wrapper::set_snapshot_staleness(int max_instances, int max_millis) {
+    for (auto& classifier : classifiers) {
+        classifier->set_snapshot_staleness(max_instances, max_millis);
+    }
+}
+
+int trans_tree_wrapper::predict_snapshot() {
+    return current_classifier->predict_snapshot();
+}
+
+void trans_tree_wrapper::enable_async_training(int queue_capacity, string overflow_policy) {
+    for (auto& classifier : classifiers) {
+        classifier->enable_async_training(queue_capacity, overflow_policy);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_training_queue_stats() {
+    return current_classifier->get_training_queue_stats();
+}
+
+void trans_tree_wrapper::set_load_shedding(double target_rate) {
+    for (auto& classifier : classifiers) {
+        classifier->set_load_shedding(target_rate);
+    }
+}
+
+void trans_tree_wrapper::set_instance_store_encoding(string encoding_str) {
+    for (auto& classifier : classifiers) {
+        classifier->set_instance_store_encoding(encoding_str);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_load_shedding_stats() {
+    return current_classifier->get_load_shedding_stats();
+}
+
+void trans_tree_wrapper::set_spill_threshold(long threshold_bytes) {
+    for (auto& classifier : classifiers) {
+        classifier->set_spill_threshold(threshold_bytes);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_spill_stats() {
+    return current_classifier->get_spill_stats();
+}
+
+void trans_tree_wrapper::set_instance_summary_size(int max_representatives) {
+    for (auto& classifier : classifiers) {
+        classifier->set_instance_summary_size(max_representatives);
+    }
+}
+
+void trans_tree_wrapper::set_tree_backend(string backend_str) {
+    for (auto& classifier : classifiers) {
+        classifier->set_tree_backend(backend_str);
+    }
+}
+
+void trans_tree_wrapper::set_deferred_reclamation(bool enabled) {
+    for (auto& classifier : classifiers) {
+        classifier->set_deferred_reclamation(enabled);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_reclamation_stats() {
+    return current_classifier->get_reclamation_stats();
+}
+
+void trans_tree_wrapper::set_pool_drift_detector(string detector_str) {
+    for (auto& classifier : classifiers) {
+        classifier->set_pool_drift_detector(detector_str);
+    }
+}
+
+void trans_tree_wrapper::set_memory_budget(long tree_bytes, long pool_bytes) {
+    for (auto& classifier : classifiers) {
+        classifier->set_memory_budget(tree_bytes, pool_bytes);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_tree_model_bytes() {
+    return current_classifier->get_tree_model_bytes();
+}
+
+void trans_tree_wrapper::set_shared_pool_observations(bool enabled) {
+    for (auto& classifier : classifiers) {
+        classifier->set_shared_pool_observations(enabled);
+    }
+}
+
+// one discretizer for all learners: a transferred tree's split on a bin
+// index must mean the same range in its new learner
+void trans_tree_wrapper::set_discretization(int num_bins) {
+    shared_ptr<quantile_discretizer> discretizer = nullptr;
+    if (num_bins > 0) {
+        discretizer = make_shared<quantile_discretizer>(num_bins, discretization_warmup);
+    }
+    for (auto& classifier : classifiers) {
+        classifier->set_discretizer(discretizer);
+    }
+}
+
+void trans_tree_wrapper::set_observer_isa(string isa_str) {
+    for (auto& classifier : classifiers) {
+        classifier->set_observer_isa(isa_str);
+    }
+}
+
+void trans_tree_wrapper::set_adaptive_grace_period(bool enabled) {
+    for (auto& classifier : classifiers) {
+        classifier->set_adaptive_grace_period(enabled);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_split_attempt_stats() {
+    return current_classifier->get_split_attempt_stats();
+}
+
+void trans_tree_wrapper::set_split_workers(int num_workers) {
+    for (auto& classifier : classifiers) {
+        classifier->set_split_workers(num_workers);
+    }
+}
+
+vector<long> trans_tree_wrapper::get_split_scheduler_stats() {
+    return current_classifier->get_split_scheduler_stats();
+}
+
+void trans_tree_wrapper::set_attribute_workers(int num_workers, int min_attributes) {
+    for (auto& classifier : classifiers) {
+        classifier->set_attribute_workers(num_workers, min_attributes);
+    }
+}
+
+void trans_tree_wrapper::set_replay_batch_size(int batch_size) {
+    for (auto& classifier : classifiers) {
+        classifier->set_replay_batch_size(batch_size);
+    }
+}
@@ -32,10 +32,51 @@ public:
     int get_transferred_tree_group_size();
     int get_tree_pool_size();
 
+    void set_snapshot_staleness(int max_instances, int max_millis);
+    int predict_snapshot();
+
+    void enable_async_training(int queue_capacity, string overflow_policy);
+    vector<long> get_training_queue_stats();
+
+    void set_load_shedding(double target_rate);
+    void set_instance_store_encoding(string encoding_str);
+    vector<long> get_load_shedding_stats();
+
+    void set_spill_threshold(long threshold_bytes);
+    vector<long> get_spill_stats();
+
+    void set_instance_summary_size(int max_representatives);
+    void set_tree_backend(string backend_str);
+
+    void set_deferred_reclamation(bool enabled);
+    vector<long> get_reclamation_stats();
+
+    void set_pool_drift_detector(string detector_str);
+
+    void set_memory_budget(long tree_bytes, long pool_bytes);
+    vector<long> get_tree_model_bytes();
+
+    void set_shared_pool_observations(bool enabled);
+
+    void set_discretization(int num_bins);
+    void set_observer_isa(string isa_str);
+
+    void set_adaptive_grace_period(bool enabled);
+    vector<long> get_split_attempt_stats();
+
+    void set_split_workers(int num_workers);
+    vector<long> get_split_scheduler_stats();
+
+    void set_attribute_workers(int num_workers, int min_attributes);
+
+    void set_replay_batch_size(int batch_size);
+
 private:
 
     vector<shared_ptr<trans_tree>> classifiers;
     shared_ptr<trans_tree> current_classifier;
+    // instances the shared discretizer's cut points are fit on
+    int discretization_warmup = 1000;
 
 };
 
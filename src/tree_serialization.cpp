@@ -0,0 +1,49 @@
+#include "tree_serialization.h"
+
+string serialize_tree(HT::HoeffdingTree& tree) {
+    Json::Value jv;
+    if (!tree.exportToJson(jv)) {
+        cout << "serialize_tree: failed to export tree" << endl;
+        exit(1);
+    }
+
+    Json::FastWriter writer;
+    return writer.write(jv);
+}
+
+unique_ptr<HT::HoeffdingTree> deserialize_tree(const string& buffer) {
+    Json::Value jv;
+    Json::Reader reader;
+    if (!reader.parse(buffer, jv)) {
+        cout << "deserialize_tree: malformed tree buffer" << endl;
+        exit(1);
+    }
+
+    unique_ptr<HT::HoeffdingTree> tree = make_unique<HT::HoeffdingTree>();
+    if (!tree->importFromJson(jv)) {
+        cout << "deserialize_tree: failed to import tree" << endl;
+        exit(1);
+    }
+
+    return tree;
+}
+
+unique_ptr<HT::HoeffdingTree> clone_tree(HT::HoeffdingTree& tree) {
+    return deserialize_tree(serialize_tree(tree));
+}
+
+void write_bytes(string& buffer, const string& bytes) {
+    write_value<long>(buffer, bytes.size());
+    buffer.append(bytes);
+}
+
+string read_bytes(const string& buffer, size_t& pos) {
+    long length = read_value<long>(buffer, pos);
+    if (length < 0 || pos + length > buffer.size()) {
+        cout << "read_bytes: truncated buffer" << endl;
+        exit(1);
+    }
+    string bytes = buffer.substr(pos, length);
+    pos += length;
+    return bytes;
+}
@@ -0,0 +1,35 @@
+#ifndef TREE_SERIALIZATION_H
+#define TREE_SERIALIZATION_H
+
+#include <cstring>
+
+#include <streamDM/learners/Classifiers/Trees/HoeffdingTree.h>
+
+// Hoeffding trees are copied through streamDM's JSON model export/import,
+// which rebuilds the full node structure including leaf statistics.
+string serialize_tree(HT::HoeffdingTree& tree);
+unique_ptr<HT::HoeffdingTree> deserialize_tree(const string& buffer);
+unique_ptr<HT::HoeffdingTree> clone_tree(HT::HoeffdingTree& tree);
+
+// flat binary packing of learner state, native byte order (same process only)
+template <typename T>
+void write_value(string& buffer, const T& value) {
+    buffer.append((const char*) &value, sizeof(T));
+}
+
+template <typename T>
+T read_value(const string& buffer, size_t& pos) {
+    if (pos + sizeof(T) > buffer.size()) {
+        cout << "read_value: truncated buffer" << endl;
+        exit(1);
+    }
+    T value;
+    memcpy(&value, buffer.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+void write_bytes(string& buffer, const string& bytes);
+string read_bytes(const string& buffer, size_t& pos);
+
+#endif //TREE_SERIALIZATION_H
@@ -0,0 +1,24 @@
+#include "weighted_training.h"
+
+void train_weighted(HT::HoeffdingTree& tree, const Instance& instance, double weight) {
+    // streamDM getters are not const-qualified, nothing is written through this reference
+    Instance& source = const_cast<Instance&>(instance);
+    if (source.getWeight() == weight) {
+        tree.train(instance);
+        return;
+    }
+
+    const DenseInstance* dense_instance = dynamic_cast<const DenseInstance*>(&instance);
+    if (dense_instance == nullptr) {
+        cout << "train_weighted: only dense instances are supported" << endl;
+        exit(1);
+    }
+
+    // the buffers keep their capacity, so after the first call nothing is allocated
+    static thread_local DenseInstance scratch_instance;
+    scratch_instance.mInputData.assign(dense_instance->mInputData.begin(), dense_instance->mInputData.end());
+    scratch_instance.mOutputData.assign(dense_instance->mOutputData.begin(), dense_instance->mOutputData.end());
+    scratch_instance.setInstanceInformation(source.getInstanceInformation());
+    scratch_instance.setWeight(weight);
+    tree.train(scratch_instance);
+}
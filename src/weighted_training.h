@@ -0,0 +1,12 @@
+#ifndef WEIGHTED_TRAINING_H
+#define WEIGHTED_TRAINING_H
+
+#include <streamDM/learners/Classifiers/Trees/HoeffdingTree.h>
+
+// Trains tree on instance as if the instance carried `weight`.
+// streamDM reads the training weight from the instance, so another weight
+// is set on a per-thread scratch instance whose value and label buffers are
+// overwritten with the instance's; ingested instances are never written.
+void train_weighted(HT::HoeffdingTree& tree, const Instance& instance, double weight);
+
+#endif //WEIGHTED_TRAINING_H